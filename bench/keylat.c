@@ -0,0 +1,279 @@
+// Keystroke-to-echo latency harness for the line editor.
+//
+// Runs jshell on a pseudo-terminal, replays keystroke streams one key at
+// a time and measures how long each key takes to produce terminal output.
+// Each stream is replayed twice: once on a quiet shell, and once while a
+// queue of short background jobs prints Done/launch notifications.
+//
+// Usage: keylat [-n repeats] [-f stream-file] [-d gap-ms] [jshell-binary]
+//   -f  replay this stream instead of the built-in ones; C escapes
+//       (\n \t \e \\ \xNN) are decoded and each line should end in \n
+//
+// Output: JSON percentiles on stdout, one object per mode.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pty.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#define KEY_TIMEOUT_MS 500
+#define PROMPT_TIMEOUT_MS 5000
+#define PROMPT_MARK "jshell>"
+
+// Built-in streams: plain typing, tab completion, history arrows and
+// mid-line inserts (arrow left, then type).
+static const char *builtin_streams[] = {
+    "echo hello world\n",
+    "cat alp\t\x7f\x7f\x7fpha.t\t\n",
+    "\x1b[A\x1b[A\x1b[B\n",
+    "echo wrld\x1b[D\x1b[D\x1b[Do\n",
+    "printf '%s\\n' one two three | wc -l\n",
+    NULL
+};
+
+static int master_fd = -1;
+static pid_t shell_pid = -1;
+static char tail_buf[8192];
+static size_t tail_len = 0;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Reads whatever output is ready within timeout_ms, keeping the tail of
+// everything seen so far for prompt detection. Returns bytes read.
+static ssize_t pump(int timeout_ms, char *out, size_t out_size) {
+    struct pollfd pfd = { master_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+    char buf[4096];
+    ssize_t n = read(master_fd, buf, sizeof(buf));
+    if (n <= 0) return 0;
+    if (tail_len + n > sizeof(tail_buf)) {
+        size_t keep = sizeof(tail_buf) / 2;
+        if (keep > tail_len) keep = tail_len;
+        memmove(tail_buf, tail_buf + tail_len - keep, keep);
+        tail_len = keep;
+    }
+    if ((size_t)n <= sizeof(tail_buf) - tail_len) {
+        memcpy(tail_buf + tail_len, buf, n);
+        tail_len += n;
+    }
+    if (out) memcpy(out, buf, (size_t)n < out_size ? (size_t)n : out_size);
+    return n;
+}
+
+static int wait_for_prompt(void) {
+    tail_len = 0;
+    double deadline = now_us() + PROMPT_TIMEOUT_MS * 1e3;
+    while (now_us() < deadline) {
+        pump(50, NULL, 0);
+        if (memmem(tail_buf, tail_len, PROMPT_MARK, strlen(PROMPT_MARK)))
+            return 0;
+    }
+    return -1;
+}
+
+static void drain(int ms) {
+    double deadline = now_us() + ms * 1e3;
+    while (now_us() < deadline)
+        pump(1, NULL, 0);
+}
+
+static void send_line(const char *line) {
+    if (write(master_fd, line, strlen(line)) < 0) perror("write");
+    wait_for_prompt();
+}
+
+typedef struct {
+    double *v;
+    int n, cap;
+    int timeouts;
+} samples_t;
+
+static void add_sample(samples_t *s, double us) {
+    if (s->n == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 256;
+        s->v = realloc(s->v, sizeof(double) * s->cap);
+    }
+    s->v[s->n++] = us;
+}
+
+// Sends one key. Printable keys count once their character is echoed;
+// escape sequences, tab and backspace count on any output.
+static void press(const char *key, size_t len, samples_t *s) {
+    char echo[4096];
+    int printable = (len == 1 && key[0] >= 0x20 && key[0] < 0x7f);
+    double start = now_us();
+    if (write(master_fd, key, len) < 0) { perror("write"); return; }
+    double deadline = start + KEY_TIMEOUT_MS * 1e3;
+    while (now_us() < deadline) {
+        ssize_t n = pump(KEY_TIMEOUT_MS, echo, sizeof(echo));
+        if (n > 0 && (!printable || memchr(echo, key[0], n))) {
+            add_sample(s, now_us() - start);
+            return;
+        }
+    }
+    s->timeouts++;
+}
+
+// Replays a stream key by key; a newline waits for the next prompt.
+static void replay(const char *stream, int gap_ms, samples_t *s) {
+    for (const char *p = stream; *p; ) {
+        size_t len = 1;
+        if (p[0] == '\x1b' && p[1] == '[' && p[2]) len = 3;
+        if (*p == '\n') {
+            if (write(master_fd, "\n", 1) < 0) perror("write");
+            wait_for_prompt();
+        } else {
+            press(p, len, s);
+            drain(gap_ms);
+        }
+        p += len;
+    }
+}
+
+// Decodes \n \t \e \\ \xNN escapes from a recorded stream file.
+static char *load_stream(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); exit(1); }
+    char *raw = NULL;
+    size_t cap = 0;
+    ssize_t len = getdelim(&raw, &cap, '\0', f);
+    fclose(f);
+    if (len < 0) { fprintf(stderr, "%s: empty\n", path); exit(1); }
+    char *out = malloc(len + 1);
+    size_t o = 0;
+    for (ssize_t i = 0; i < len; i++) {
+        if (raw[i] == '\n') continue;   // real newlines only separate lines
+        if (raw[i] != '\\' || i + 1 >= len) { out[o++] = raw[i]; continue; }
+        char c = raw[++i];
+        if (c == 'n') out[o++] = '\n';
+        else if (c == 't') out[o++] = '\t';
+        else if (c == 'e') out[o++] = '\x1b';
+        else if (c == 'x' && i + 2 < len) {
+            char hex[3] = { raw[i + 1], raw[i + 2], 0 };
+            out[o++] = (char)strtol(hex, NULL, 16);
+            i += 2;
+        } else out[o++] = c;
+    }
+    out[o] = '\0';
+    free(raw);
+    return out;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(samples_t *s, double p) {
+    if (s->n == 0) return 0;
+    int i = (int)(p / 100.0 * (s->n - 1) + 0.5);
+    return s->v[i];
+}
+
+static void report(const char *mode, samples_t *s, int last) {
+    qsort(s->v, s->n, sizeof(double), cmp_double);
+    printf("    {\"bench\": \"keystroke\", \"mode\": \"%s\", \"keys\": %d, \"timeouts\": %d, "
+           "\"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f}%s\n",
+           mode, s->n, s->timeouts, percentile(s, 50), percentile(s, 90),
+           percentile(s, 99), s->n ? s->v[s->n - 1] : 0.0, last ? "" : ",");
+    fprintf(stderr, "  %-6s keys %5d  p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  timeouts %d\n",
+            mode, s->n, percentile(s, 50), percentile(s, 90), percentile(s, 99), s->timeouts);
+}
+
+static void start_shell(const char *jshell, const char *home) {
+    struct winsize ws = { 40, 120, 0, 0 };
+    shell_pid = forkpty(&master_fd, NULL, NULL, &ws);
+    if (shell_pid < 0) { perror("forkpty"); exit(1); }
+    if (shell_pid == 0) {
+        setenv("HOME", home, 1);
+        setenv("TERM", "dumb", 1);
+        if (chdir(home) < 0) _exit(126);
+        execl(jshell, jshell, (char *)NULL);
+        perror(jshell);
+        _exit(127);
+    }
+    if (wait_for_prompt() < 0) {
+        fprintf(stderr, "keylat: no prompt from %s\n", jshell);
+        exit(1);
+    }
+}
+
+// Queues short jobs one slot at a time so notifications keep arriving
+// while the stream is replayed.
+static void start_noise(void) {
+    send_line("maxjobs 1\n");
+    send_line("for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 do /bin/sleep 0.02 & done\n");
+}
+
+int main(int argc, char *argv[]) {
+    int repeats = 20, gap_ms = 2, opt;
+    const char *stream_file = NULL;
+    while ((opt = getopt(argc, argv, "n:f:d:")) != -1) {
+        switch (opt) {
+            case 'n': repeats = atoi(optarg); break;
+            case 'f': stream_file = optarg; break;
+            case 'd': gap_ms = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-n repeats] [-f stream-file] [-d gap-ms] [jshell]\n", argv[0]);
+                return 2;
+        }
+    }
+    char jshell[4096];
+    if (!realpath(optind < argc ? argv[optind] : "./bin/jshell", jshell)) {
+        perror("jshell");
+        return 1;
+    }
+    char home[] = "/tmp/keylat.XXXXXX";
+    if (!mkdtemp(home)) { perror("mkdtemp"); return 1; }
+    // Files for the tab-completion stream.
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/alpha.txt", home);
+    fclose(fopen(path, "w"));
+    snprintf(path, sizeof(path), "%s/alphabet.txt", home);
+    fclose(fopen(path, "w"));
+
+    const char *custom[2] = { NULL, NULL };
+    const char **streams = builtin_streams;
+    if (stream_file) {
+        custom[0] = load_stream(stream_file);
+        streams = custom;
+    }
+
+    start_shell(jshell, home);
+    samples_t quiet = { 0 }, noisy = { 0 };
+    fprintf(stderr, "Replaying %d x %s through %s\n", repeats,
+            stream_file ? stream_file : "built-in streams", jshell);
+    for (int r = 0; r < repeats; r++)
+        for (int i = 0; streams[i]; i++)
+            replay(streams[i], gap_ms, &quiet);
+    for (int r = 0; r < repeats; r++) {
+        start_noise();
+        for (int i = 0; streams[i]; i++)
+            replay(streams[i], gap_ms, &noisy);
+    }
+    send_line("wait\n");
+    if (write(master_fd, "exit\n", 5) < 0) perror("write");
+    drain(100);
+    kill(shell_pid, SIGTERM);
+    waitpid(shell_pid, NULL, 0);
+
+    printf("{\n  \"jshell\": \"%s\",\n  \"results\": [\n", jshell);
+    report("quiet", &quiet, 0);
+    report("noisy", &noisy, 1);
+    printf("  ]\n}\n");
+
+    snprintf(path, sizeof(path), "rm -rf '%s'", home);
+    if (system(path) != 0) fprintf(stderr, "keylat: could not remove %s\n", home);
+    return 0;
+}
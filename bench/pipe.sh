@@ -0,0 +1,29 @@
+#!/bin/bash
+# Measures pipeline throughput (MB/s) across 2-8 stages, with the default
+# pipe capacity and with JSHELL_PIPE_SIZE throughput mode.
+#
+# Usage: bench/pipe.sh [jshell-binary] [megabytes] [pipe-size]
+
+JSHELL=${1:-./bin/jshell}
+MB=${2:-512}
+SIZE=${3:-1m}
+
+run() {
+    local stages=$1 size=$2
+    local line="head -c ${MB}M /dev/zero"
+    for ((i = 1; i < stages; i++)); do
+        line="$line | cat"
+    done
+    line="$line > /dev/null"
+    local start end
+    start=$(date +%s.%N)
+    JSHELL_PIPE_SIZE=$size "$JSHELL" -c "$line" < /dev/null
+    end=$(date +%s.%N)
+    awk -v mb="$MB" -v s="$start" -v e="$end" -v n="$stages" -v z="${size:-default}" \
+        'BEGIN { printf "%d stages  pipe=%-8s %8.3f s %10.1f MB/s\n", n, z, e - s, mb / (e - s) }'
+}
+
+for stages in 2 3 4 5 6 7 8; do
+    run "$stages" ""
+    run "$stages" "$SIZE"
+done
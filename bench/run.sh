@@ -0,0 +1,301 @@
+#!/bin/bash
+# Benchmarks the shell's hot paths and prints the results as JSON.
+#
+#   parse      parse_input throughput on generated lines (script run under set -n
+#              with --no-script-cache), and heap allocations per parsed line
+#   script_cache  the same script loaded from a cold and a warm compiled cache
+#   invoke     -c invocations per second
+#   loop       for-loop iterations per second through execute_script
+#   alias      extra cost per command of going through an alias
+#   pipeline   MB/s pushed through 1..4 cat stages
+#   jobs       background jobs launched and reaped per second
+#   range      for-loop iterations per second over {1..N}, stepped lazily
+#   glob       directory entries per second scanned by *.log, f1* and
+#              f*[05].log in a directory of 1M files
+#   stress     a 100k-argument command run directly and through an alias,
+#              and a 1M-item for loop; a wrong word count fails the run
+#
+# Usage: bench/run.sh [--compare] [--quick] [jshell-binary]
+#   --compare  also run the -c, loop and pipeline benchmarks under bash
+#              and dash when they are installed
+#   --quick    smaller workloads, for a fast smoke run
+#
+# Output: {"jshell": ..., "results": [{"bench", "shell", "value", "unit"}, ...]}
+
+COMPARE=0
+SCALE=1
+while [[ $1 == --* ]]; do
+    case $1 in
+        --compare) COMPARE=1 ;;
+        --quick) SCALE=10 ;;
+        *) echo "unknown option: $1" >&2; exit 2 ;;
+    esac
+    shift
+done
+JSHELL=$(realpath "${1:-./bin/jshell}")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+# Compiled script caches go to the scratch directory, not ~/.cache.
+export XDG_CACHE_HOME="$WORK/cache"
+
+PARSE_LINES=$((20000 / SCALE))
+INVOCATIONS=$((1000 / SCALE))
+LOOP_REPEAT=$((20 / SCALE))
+ALIAS_LINES=$((20000 / SCALE))
+PIPE_MB=$((256 / SCALE))
+JOB_COUNT=$((2000 / SCALE))
+RANGE_ITEMS=$((1000000 / SCALE))
+GLOB_FILES=$((1000000 / SCALE))
+STRESS_ARGS=$((100000 / SCALE))
+STRESS_ITEMS=$((1000000 / SCALE))
+
+SHELLS=(jshell)
+if ((COMPARE)); then
+    for sh in bash dash; do
+        command -v "$sh" > /dev/null && SHELLS+=("$sh")
+    done
+fi
+
+RESULTS=()
+
+# Seconds (float) spent running "$@" with output discarded.
+elapsed() {
+    local start=$EPOCHREALTIME
+    "$@" < /dev/null > /dev/null 2>&1
+    local end=$EPOCHREALTIME
+    awk -v s="$start" -v e="$end" 'BEGIN { printf "%.6f", e - s }'
+}
+
+# record BENCH SHELL COUNT SECONDS UNIT: stores COUNT/SECONDS.
+record() {
+    local rate
+    rate=$(awk -v n="$3" -v t="$4" 'BEGIN { printf "%.1f", (t > 0) ? n / t : 0 }')
+    RESULTS+=("{\"bench\": \"$1\", \"shell\": \"$2\", \"value\": $rate, \"unit\": \"$5\"}")
+    echo "  $1 [$2]: $rate $5" >&2
+}
+
+shell_bin() {
+    if [[ $1 == jshell ]]; then echo "$JSHELL"; else command -v "$1"; fi
+}
+
+# 1..N separated by spaces.
+seq_list() { seq -s ' ' 1 "$1"; }
+
+bench_parse() {
+    local lines=(
+        'ls -l /tmp | grep foo | sort -r > out.txt'
+        'if test -f /etc/passwd then echo yes else echo no fi'
+        'for i in a b c d e f do echo $i done'
+        'cat < in.txt | tr a-z A-Z >> out.txt &'
+        'true && echo ok || echo fail'
+        'case $X in a) echo a ;; b) echo b ;; *) echo other ;; esac'
+        '( cd /tmp ; ls ) | wc -l'
+        'export FOO=bar ; echo $FOO ; unset FOO'
+    )
+    {
+        echo "set -n"
+        for ((i = 0; i < PARSE_LINES; i++)); do
+            echo "${lines[i % ${#lines[@]}]}"
+        done
+    } > parse.jsh
+    echo "set -n" > empty.jsh
+    local t base
+    t=$(elapsed "$JSHELL" --no-script-cache parse.jsh)
+    base=$(elapsed "$JSHELL" --no-script-cache empty.jsh)
+    t=$(awk -v t="$t" -v b="$base" 'BEGIN { d = t - b; printf "%.6f", (d > 0 ? d : t) }')
+    record parse jshell "$PARSE_LINES" "$t" lines/sec
+    # Heap allocations made per parsed line, from --alloc-stats.
+    local mallocs
+    mallocs=$("$JSHELL" --no-script-cache --alloc-stats parse.jsh 2>&1 > /dev/null |
+        awk '/mallocs/ { gsub(/\(/, "", $4); print $4 }')
+    RESULTS+=("{\"bench\": \"parse_mallocs\", \"shell\": \"jshell\", \"value\": ${mallocs:-0}, \"unit\": \"mallocs/line\"}")
+    echo "  parse_mallocs [jshell]: ${mallocs:-0} mallocs/line" >&2
+}
+
+# Reuses parse.jsh from bench_parse. The cold run compiles and writes the
+# cache; the warm run maps it.
+bench_script_cache() {
+    local cold warm
+    rm -rf "$XDG_CACHE_HOME"
+    cold=$(elapsed "$JSHELL" parse.jsh)
+    warm=$(elapsed "$JSHELL" parse.jsh)
+    record script_cache_cold jshell "$PARSE_LINES" "$cold" lines/sec
+    record script_cache_warm jshell "$PARSE_LINES" "$warm" lines/sec
+}
+
+run_c_loop() {
+    local sh=$1
+    for ((i = 0; i < INVOCATIONS; i++)); do
+        "$sh" -c true
+    done
+}
+
+bench_invoke() {
+    for name in "${SHELLS[@]}"; do
+        local bin t
+        bin=$(shell_bin "$name")
+        t=$(elapsed run_c_loop "$bin")
+        record invoke "$name" "$INVOCATIONS" "$t" invocations/sec
+    done
+}
+
+bench_loop() {
+    local outer inner
+    outer=$(seq_list 50)
+    inner=$(seq_list 50)
+    local iterations=$((LOOP_REPEAT * 50 * 50))
+    for ((r = 0; r < LOOP_REPEAT; r++)); do
+        echo "for i in $outer do for j in $inner do : done done"
+    done > loop.jsh
+    for ((r = 0; r < LOOP_REPEAT; r++)); do
+        echo "for i in $outer; do for j in $inner; do :; done; done"
+    done > loop.sh
+    for name in "${SHELLS[@]}"; do
+        local bin t
+        bin=$(shell_bin "$name")
+        if [[ $name == jshell ]]; then
+            t=$(elapsed "$bin" loop.jsh)
+        else
+            t=$(elapsed "$bin" loop.sh)
+        fi
+        record loop "$name" "$iterations" "$t" iterations/sec
+    done
+}
+
+bench_alias() {
+    {
+        echo "alias t=':'"
+        for ((i = 0; i < ALIAS_LINES; i++)); do echo "t"; done
+    } > alias.jsh
+    for ((i = 0; i < ALIAS_LINES; i++)); do echo ":"; done > plain.jsh
+    local ta tp
+    ta=$(elapsed "$JSHELL" alias.jsh)
+    tp=$(elapsed "$JSHELL" plain.jsh)
+    # Cost of the alias lookup and re-parse on top of running the command.
+    local per
+    per=$(awk -v a="$ta" -v p="$tp" -v n="$ALIAS_LINES" \
+        'BEGIN { d = (a - p) / n * 1e6; printf "%.3f", (d > 0 ? d : 0) }')
+    RESULTS+=("{\"bench\": \"alias\", \"shell\": \"jshell\", \"value\": $per, \"unit\": \"us/expansion\"}")
+    echo "  alias [jshell]: $per us/expansion" >&2
+    record alias_cmds jshell "$ALIAS_LINES" "$ta" commands/sec
+}
+
+bench_pipeline() {
+    local bytes=$((PIPE_MB * 1024 * 1024))
+    for stages in 1 2 3 4; do
+        local line="head -c $bytes /dev/zero"
+        for ((s = 0; s < stages; s++)); do line="$line | cat"; done
+        for name in "${SHELLS[@]}"; do
+            local bin t
+            bin=$(shell_bin "$name")
+            t=$(elapsed "$bin" -c "$line")
+            record "pipeline_$stages" "$name" "$PIPE_MB" "$t" MB/sec
+        done
+    done
+}
+
+bench_jobs() {
+    local per=50
+    local rounds=$((JOB_COUNT / per))
+    local list
+    list=$(seq_list "$per")
+    {
+        echo "maxjobs $JOB_COUNT"
+        for ((r = 0; r < rounds; r++)); do
+            echo "for i in $list do /bin/true & done"
+        done
+        echo "jobs"
+        echo "wait"
+    } > jobs.jsh
+    local t
+    t=$(elapsed "$JSHELL" jobs.jsh)
+    record jobs jshell "$((rounds * per))" "$t" jobs/sec
+}
+
+bench_range() {
+    echo "for i in {1..$RANGE_ITEMS} do : done" > range.jsh
+    echo "for i in {1..$RANGE_ITEMS}; do :; done" > range.sh
+    for name in "${SHELLS[@]}"; do
+        local bin t
+        bin=$(shell_bin "$name")
+        # dash has no brace expansion.
+        [[ $name == dash ]] && continue
+        if [[ $name == jshell ]]; then
+            t=$(elapsed "$bin" range.jsh)
+        else
+            t=$(elapsed "$bin" range.sh)
+        fi
+        record range "$name" "$RANGE_ITEMS" "$t" iterations/sec
+    done
+}
+
+bench_glob() {
+    mkdir -p globdir
+    (cd globdir && seq 1 "$GLOB_FILES" |
+        awk '{ print "f" $1 (NR % 2 ? ".log" : ".txt") }' | xargs touch)
+    local kinds=(suffix prefix pattern)
+    local patterns=('*.log' 'f1*' 'f*[05].log')
+    for ((k = 0; k < ${#kinds[@]}; k++)); do
+        for name in "${SHELLS[@]}"; do
+            local bin t
+            bin=$(shell_bin "$name")
+            t=$(cd globdir && elapsed "$bin" -c "echo ${patterns[k]}")
+            record "glob_${kinds[k]}" "$name" "$GLOB_FILES" "$t" entries/sec
+        done
+    done
+    rm -rf globdir
+}
+
+# Argument vectors, for lists and alias expansions have no fixed capacity;
+# these runs check the counts come through intact, not just the speed.
+bench_stress() {
+    local args
+    args=$(seq_list "$STRESS_ARGS")
+    {
+        echo "/bin/echo $args > direct.out"
+        echo "alias big=/bin/echo"
+        echo "big $args > alias.out"
+    } > stress_args.jsh
+    echo "for i in $(seq_list "$STRESS_ITEMS") do : done" > stress_for.jsh
+    echo 'echo $i > for.out' >> stress_for.jsh
+    local t
+    t=$(elapsed "$JSHELL" --no-script-cache stress_args.jsh)
+    for out in direct.out alias.out; do
+        local words
+        words=$(wc -w < "$out" 2> /dev/null)
+        if [[ $words != "$STRESS_ARGS" ]]; then
+            echo "stress: $out has ${words:-no} words, expected $STRESS_ARGS" >&2
+            exit 1
+        fi
+    done
+    record stress_args jshell "$((STRESS_ARGS * 2))" "$t" args/sec
+    t=$(elapsed "$JSHELL" --no-script-cache stress_for.jsh)
+    if [[ $(cat for.out 2> /dev/null) != "$STRESS_ITEMS" ]]; then
+        echo "stress: for loop stopped before item $STRESS_ITEMS" >&2
+        exit 1
+    fi
+    record stress_for jshell "$STRESS_ITEMS" "$t" iterations/sec
+}
+
+echo "Running benchmarks against $JSHELL" >&2
+bench_parse
+bench_script_cache
+bench_invoke
+bench_loop
+bench_alias
+bench_pipeline
+bench_jobs
+bench_range
+bench_glob
+bench_stress
+
+{
+    printf '{\n  "jshell": "%s",\n  "results": [\n' "$JSHELL"
+    for ((i = 0; i < ${#RESULTS[@]}; i++)); do
+        sep=","
+        ((i == ${#RESULTS[@]} - 1)) && sep=""
+        printf '    %s%s\n' "${RESULTS[i]}" "$sep"
+    done
+    printf '  ]\n}\n'
+}
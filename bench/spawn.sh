@@ -0,0 +1,28 @@
+#!/bin/bash
+# Measures external-command launch throughput (commands/sec) through
+# execute_script, comparing the posix_spawn fast path with the fork path.
+#
+# Usage: bench/spawn.sh [jshell-binary] [command-count]
+
+JSHELL=${1:-./bin/jshell}
+COUNT=${2:-5000}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+SCRIPT="$WORK/spawn.jsh"
+for ((i = 0; i < COUNT; i++)); do
+    echo "/bin/true"
+done > "$SCRIPT"
+
+run() {
+    local mode=$1
+    local start end
+    start=$(date +%s.%N)
+    JSHELL_SPAWN=$mode "$JSHELL" "$SCRIPT" < /dev/null > /dev/null
+    end=$(date +%s.%N)
+    awk -v n="$COUNT" -v s="$start" -v e="$end" -v m="$mode" \
+        'BEGIN { printf "%-6s %8d cmds %8.3f s %10.1f cmds/sec\n", m, n, e - s, n / (e - s) }'
+}
+
+run fork
+run spawn
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+// First block size; later blocks double, or fit one oversized request.
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGN (sizeof(void *))
+
+typedef struct arena_block_t {
+    struct arena_block_t *prev;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+} arena_block_t;
+
+struct arena_t {
+    arena_block_t *current;
+};
+
+// Counters for --alloc-stats.
+static unsigned long stat_arenas = 0;
+static unsigned long stat_allocs = 0;
+static unsigned long stat_mallocs = 0;
+static unsigned long stat_bytes = 0;
+
+static arena_block_t *block_new(size_t size, size_t extra) {
+    arena_block_t *block = malloc(sizeof(arena_block_t) + extra + size);
+    if (!block) return NULL;
+    stat_mallocs++;
+    block->prev = NULL;
+    block->size = extra + size;
+    block->used = extra;
+    return block;
+}
+
+arena_t *arena_create(void) {
+    // The arena header lives at the start of its first block.
+    size_t header = (sizeof(arena_t) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    arena_block_t *block = block_new(ARENA_BLOCK_SIZE, header);
+    if (!block) return NULL;
+    arena_t *arena = (arena_t *)block->data;
+    arena->current = block;
+    stat_arenas++;
+    return arena;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    arena_block_t *block = arena->current;
+    if (block->size - block->used < size) {
+        size_t next = block->size * 2;
+        if (next < size) next = size;
+        arena_block_t *grown = block_new(next, 0);
+        if (!grown) return NULL;
+        grown->prev = block;
+        arena->current = block = grown;
+    }
+    void *p = (char *)block->data + block->used;
+    block->used += size;
+    memset(p, 0, size);
+    stat_allocs++;
+    stat_bytes += size;
+    return p;
+}
+
+char *arena_strndup(arena_t *arena, const char *s, size_t n) {
+    if (!s) return NULL;
+    char *copy = arena_alloc(arena, n + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, n);
+    copy[n] = '\0';
+    return copy;
+}
+
+char *arena_strdup(arena_t *arena, const char *s) {
+    return s ? arena_strndup(arena, s, strlen(s)) : NULL;
+}
+
+void arena_destroy(arena_t *arena) {
+    if (!arena) return;
+    // The first block holds the header, so it is freed last.
+    arena_block_t *block = arena->current;
+    while (block) {
+        arena_block_t *prev = block->prev;
+        free(block);
+        block = prev;
+    }
+}
+
+void arena_report(unsigned long lines) {
+    double per = lines ? 1.0 / lines : 0;
+    fprintf(stderr, "alloc-stats: %lu lines, %lu arenas\n", lines, stat_arenas);
+    fprintf(stderr, "alloc-stats: %lu arena objects (%.1f per line), %lu bytes\n",
+            stat_allocs, stat_allocs * per, stat_bytes);
+    fprintf(stderr, "alloc-stats: %lu mallocs (%.2f per line)\n",
+            stat_mallocs, stat_mallocs * per);
+}
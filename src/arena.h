@@ -0,0 +1,59 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator backing one parse: tokens, command nodes and their
+// strings all come from the arena and are released together.
+typedef struct arena_t arena_t;
+
+/**
+ * Creates an empty arena.
+ * The header shares its malloc with the first block, so a typical command
+ * line costs a single malloc for its whole parse tree.
+ * @return New arena, or NULL if out of memory
+ * @pre None
+ * @post Caller releases it with arena_destroy()
+ */
+arena_t *arena_create(void);
+
+/**
+ * Allocates zeroed, pointer-aligned memory from the arena.
+ * @param arena Arena to allocate from
+ * @param size Bytes wanted
+ * @return Memory valid until arena_destroy(), NULL if out of memory
+ * @pre arena is non-NULL
+ * @post A new block is malloc'd only when the current one is full
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * Copies the first n bytes of s into the arena and NUL-terminates them.
+ * @return Arena copy, or NULL if s is NULL or out of memory
+ * @pre arena is non-NULL
+ */
+char *arena_strndup(arena_t *arena, const char *s, size_t n);
+
+/**
+ * Copies a string into the arena.
+ * @return Arena copy, or NULL if s is NULL or out of memory
+ * @pre arena is non-NULL
+ */
+char *arena_strdup(arena_t *arena, const char *s);
+
+/**
+ * Frees every block of the arena at once.
+ * @param arena Arena to free, may be NULL
+ * @post All memory handed out by the arena is invalid
+ */
+void arena_destroy(arena_t *arena);
+
+/**
+ * Prints allocation counters to stderr (--alloc-stats): arenas created,
+ * objects handed out, and the mallocs actually made for them.
+ * @param lines Command lines parsed, used for the per-line figures
+ * @pre None
+ */
+void arena_report(unsigned long lines);
+
+#endif
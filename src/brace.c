@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include "brace.h"
+
+// Parses a whole integer endpoint or step from s[0..len). *padded is set
+// when it has a leading zero, as in {01..10}.
+static int parse_long(const char *s, size_t len, long *out, int *padded) {
+    if (len == 0 || len >= BRACE_ITEM_MAX - 3) return 0;
+    char text[BRACE_ITEM_MAX];
+    memcpy(text, s, len);
+    text[len] = '\0';
+    const char *digits = text + (text[0] == '-' || text[0] == '+');
+    if (!isdigit((unsigned char)*digits)) return 0;
+    char *end;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    if (errno || *end) return 0;
+    *out = value;
+    if (padded) *padded = digits[0] == '0' && digits[1] != '\0';
+    return 1;
+}
+
+static const char *find_dots(const char *s, const char *end) {
+    for (; s + 1 < end; s++)
+        if (s[0] == '.' && s[1] == '.') return s;
+    return NULL;
+}
+
+// Parses "A..B" or "A..B..S", the text between the braces of a range.
+static int parse_range_body(const char *s, size_t len, brace_range_t *range) {
+    const char *end = s + len;
+    const char *dots = find_dots(s, end);
+    if (!dots) return 0;
+    const char *b = dots + 2;
+    const char *step_dots = find_dots(b, end);
+    const char *b_end = step_dots ? step_dots : end;
+    long step = 1;
+    if (step_dots && (!parse_long(step_dots + 2, end - step_dots - 2, &step, NULL) ||
+                      step == LONG_MIN))
+        return 0;
+    memset(range, 0, sizeof(*range));
+    range->step = step < 0 ? -step : step;
+    if (range->step == 0) range->step = 1;
+    size_t a_len = dots - s;
+    size_t b_len = b_end - b;
+    if (a_len == 1 && b_len == 1 && isalpha((unsigned char)s[0]) && isalpha((unsigned char)b[0])) {
+        range->letters = 1;
+        range->first = (unsigned char)s[0];
+        range->last = (unsigned char)b[0];
+        return 1;
+    }
+    int pad_a, pad_b;
+    if (!parse_long(s, a_len, &range->first, &pad_a) ||
+        !parse_long(b, b_len, &range->last, &pad_b))
+        return 0;
+    if (pad_a || pad_b) range->width = (int)(a_len > b_len ? a_len : b_len);
+    return 1;
+}
+
+int brace_parse_range(const char *word, brace_range_t *range) {
+    size_t len = strlen(word);
+    return len > 2 && word[0] == '{' && word[len - 1] == '}' &&
+           parse_range_body(word + 1, len - 2, range);
+}
+
+unsigned long brace_range_count(const brace_range_t *range) {
+    unsigned long span = range->first <= range->last
+        ? (unsigned long)range->last - (unsigned long)range->first
+        : (unsigned long)range->first - (unsigned long)range->last;
+    unsigned long steps = span / (unsigned long)range->step;
+    return steps == ULONG_MAX ? steps : steps + 1;
+}
+
+char *brace_range_item(const brace_range_t *range, unsigned long index, char *buf) {
+    unsigned long offset = index * (unsigned long)range->step;
+    long value = range->first <= range->last
+        ? (long)((unsigned long)range->first + offset)
+        : (long)((unsigned long)range->first - offset);
+    if (range->letters) {
+        buf[0] = (char)value;
+        buf[1] = '\0';
+    } else {
+        snprintf(buf, BRACE_ITEM_MAX, "%0*ld", range->width, value);
+    }
+    return buf;
+}
+
+// Finds the first brace group in word that expands: one with a top-level
+// comma, or a range (*is_range and *range are then set). "${" never opens
+// a group.
+static int find_group(const char *word, const char **open, const char **close,
+                      int *is_range, brace_range_t *range) {
+    for (const char *p = word; *p; p++) {
+        if (*p != '{' || (p > word && p[-1] == '$')) continue;
+        int depth = 0, comma = 0;
+        const char *q = p + 1;
+        for (; *q; q++) {
+            if (*q == '{') depth++;
+            else if (*q == '}' && depth-- == 0) break;
+            else if (*q == ',' && depth == 0) comma = 1;
+        }
+        if (!*q) continue;
+        *is_range = !comma && parse_range_body(p + 1, q - p - 1, range);
+        if (comma || *is_range) {
+            *open = p;
+            *close = q;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void push_word(brace_words_t *out, char *word) {
+    if (out->failed) return;
+    if (out->count == out->cap) {
+        size_t cap = out->cap ? out->cap * 2 : 8;
+        char **grown = realloc(out->words, sizeof(char*) * cap);
+        if (!grown) { out->failed = 1; return; }
+        out->words = grown;
+        out->cap = cap;
+    }
+    out->words[out->count++] = word;
+}
+
+// prefix[0..prefix_len) + middle[0..middle_len) + suffix, in the arena.
+static char *join3(arena_t *arena, const char *prefix, size_t prefix_len,
+                   const char *middle, size_t middle_len, const char *suffix) {
+    size_t suffix_len = strlen(suffix);
+    char *s = arena_alloc(arena, prefix_len + middle_len + suffix_len + 1);
+    if (!s) return NULL;
+    memcpy(s, prefix, prefix_len);
+    memcpy(s + prefix_len, middle, middle_len);
+    memcpy(s + prefix_len + middle_len, suffix, suffix_len + 1);
+    return s;
+}
+
+static void expand_into(arena_t *arena, char *word, brace_words_t *out) {
+    const char *open, *close;
+    int is_range;
+    brace_range_t range;
+    if (!find_group(word, &open, &close, &is_range, &range)) {
+        push_word(out, word);
+        return;
+    }
+    size_t prefix_len = open - word;
+    const char *suffix = close + 1;
+    char *next;
+    if (is_range) {
+        unsigned long n = brace_range_count(&range);
+        char item[BRACE_ITEM_MAX];
+        for (unsigned long i = 0; i < n && !out->failed; i++) {
+            brace_range_item(&range, i, item);
+            next = join3(arena, word, prefix_len, item, strlen(item), suffix);
+            if (!next) { out->failed = 1; return; }
+            expand_into(arena, next, out);
+        }
+        return;
+    }
+    // Split at top-level commas; each alternative may hold nested groups.
+    const char *alt = open + 1;
+    int depth = 0;
+    for (const char *q = open + 1; q <= close && !out->failed; q++) {
+        if (q == close || (*q == ',' && depth == 0)) {
+            next = join3(arena, word, prefix_len, alt, q - alt, suffix);
+            if (!next) { out->failed = 1; return; }
+            expand_into(arena, next, out);
+            alt = q + 1;
+        } else if (*q == '{') {
+            depth++;
+        } else if (*q == '}') {
+            depth--;
+        }
+    }
+}
+
+int brace_has_expansion(const char *word) {
+    const char *open, *close;
+    int is_range;
+    brace_range_t range;
+    return find_group(word, &open, &close, &is_range, &range);
+}
+
+size_t brace_expand(arena_t *arena, const char *word, brace_words_t *out) {
+    size_t before = out->count;
+    expand_into(arena, (char *)word, out);
+    return out->count - before;
+}
+
+void brace_words_free(brace_words_t *out) {
+    free(out->words);
+    memset(out, 0, sizeof(*out));
+}
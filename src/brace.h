@@ -0,0 +1,87 @@
+#ifndef BRACE_H
+#define BRACE_H
+
+#include <stddef.h>
+#include "arena.h"
+
+// Brace expansion: "x{a,b}y" is xay xby and "{1..9..2}" is 1 3 5 7 9.
+// Words are expanded once, when the line is parsed. A for list keeps a
+// word that is exactly one range as it is, and the loop steps through it
+// with brace_range_item() instead of holding every item.
+
+// Enough for a long in decimal with a sign, or a single letter.
+#define BRACE_ITEM_MAX 24
+
+// {first..last..step} over integers, or over letters when letters is set.
+typedef struct {
+    long first;
+    long last;
+    long step;      // always positive; the direction comes from first/last
+    int width;      // zero-padded width, 0 for none ({01..10})
+    int letters;
+} brace_range_t;
+
+// Words produced by brace_expand(): a malloc'd vector of arena strings.
+typedef struct {
+    char **words;
+    size_t count;
+    size_t cap;
+    int failed;     // an allocation failed; the vector may be incomplete
+} brace_words_t;
+
+/**
+ * Parses a word that is exactly one range, such as "{1..10}",
+ * "{10..1..3}", "{a..z}" or "{001..100}".
+ * @param word Word to parse
+ * @param range Filled in on success
+ * @return 1 if word is a range, 0 otherwise
+ * @pre word and range are non-NULL
+ */
+int brace_parse_range(const char *word, brace_range_t *range);
+
+/**
+ * Counts the items of a range.
+ * @param range Range from brace_parse_range()
+ * @return Number of items, at least 1
+ */
+unsigned long brace_range_count(const brace_range_t *range);
+
+/**
+ * Formats one item of a range.
+ * @param range Range from brace_parse_range()
+ * @param index Item index, below brace_range_count()
+ * @param buf Output of at least BRACE_ITEM_MAX bytes
+ * @return buf
+ */
+char *brace_range_item(const brace_range_t *range, unsigned long index, char *buf);
+
+/**
+ * Tells whether a word contains a brace group that expands: a {...} with
+ * a top-level comma, or a range. "${VAR}" and "{x}" do not.
+ * @param word Word to check
+ * @return 1 if brace_expand() would produce anything but the word itself
+ * @pre word is a non-NULL string
+ */
+int brace_has_expansion(const char *word);
+
+/**
+ * Expands every brace group in a word, left to right and nested groups
+ * included, and appends the results in order.
+ * @param arena Arena for the new strings
+ * @param word Word to expand
+ * @param out Vector to append to, zeroed before first use
+ * @return Number of words appended
+ * @pre arena, word and out are non-NULL
+ * @post Caller frees out->words with brace_words_free(). New strings live
+ *       in the arena; a word with no group is appended as it is
+ */
+size_t brace_expand(arena_t *arena, const char *word, brace_words_t *out);
+
+/**
+ * Frees the vector, not the arena strings.
+ * @param out Vector to release, may be empty
+ * @post out is zeroed and can be reused
+ */
+void brace_words_free(brace_words_t *out);
+
+#endif
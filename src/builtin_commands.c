@@ -15,6 +15,17 @@ extern int cmd_kill(command_t *cmd);
 extern int cmd_export(command_t *cmd);
 extern int cmd_unset(command_t *cmd);
 extern int cmd_env(command_t *cmd);
+extern int cmd_hash(command_t *cmd);
+extern int cmd_test(command_t *cmd);
+extern int cmd_true(command_t *cmd);
+extern int cmd_false(command_t *cmd);
+extern int cmd_pwd(command_t *cmd);
+extern int cmd_echo(command_t *cmd);
+extern int cmd_printf(command_t *cmd);
+extern int cmd_sleep(command_t *cmd);
+extern int cmd_set(command_t *cmd);
+extern int cmd_wait(command_t *cmd);
+extern int cmd_maxjobs(command_t *cmd);
 
 void register_builtin_commands(void) {
     register_command("help",   cmd_help,    "Display help message");
@@ -30,4 +41,17 @@ void register_builtin_commands(void) {
     register_command("export", cmd_export,  "Set environment variable");
     register_command("unset",  cmd_unset,   "Remove environment variable");
     register_command("env",    cmd_env,     "Display environment variables");
+    register_command("hash",   cmd_hash,    "List, clear or seed command path cache");
+    register_command("test",   cmd_test,    "Evaluate a conditional expression");
+    register_command("[",      cmd_test,    "Evaluate a conditional expression");
+    register_command("true",   cmd_true,    "Return success");
+    register_command("false",  cmd_false,   "Return failure");
+    register_command(":",      cmd_true,    "Do nothing, successfully");
+    register_command("pwd",    cmd_pwd,     "Print working directory");
+    register_command("echo",   cmd_echo,    "Write arguments to standard output");
+    register_command("printf", cmd_printf,  "Format and print arguments");
+    register_command("sleep",  cmd_sleep,   "Pause for a number of seconds");
+    register_command("set",    cmd_set,     "Set or list shell options");
+    register_command("wait",   cmd_wait,    "Wait for background jobs");
+    register_command("maxjobs",cmd_maxjobs, "Show or set background job limit");
 }
@@ -7,12 +7,15 @@
 #include <unistd.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
 #include "job_manager.h"
+#include "path_cache.h"
+#include "options.h"
 
 // Add these external declarations at the top of the file
-extern volatile int fg_wait;
-extern volatile int fg_process_done;
-extern volatile int print_prompt_pending;
+extern volatile sig_atomic_t sigint_received;
 
 // External helper functions used in executor.c
 extern void list_jobs(void);
@@ -55,6 +58,13 @@ static const char *HELP_TEXT =
     "  jobs       - List all background jobs\n"
     "  fg/bg/kill - Job control commands\n"
     "  history    - Display command history\n"
+    "  hash       - Show, clear (-r) or seed the command path cache\n"
+    "  test, [    - Evaluate file, string and integer conditions\n"
+    "  echo, printf, pwd, sleep, true, false, : - Run without forking\n"
+    "  set        - Toggle shell options (set -x, set -o lastpipe, set -o to list)\n"
+    "  wait       - Wait for background and queued jobs\n"
+    "  maxjobs    - Show or set the background job slot limit\n"
+    "  time       - Time a pipeline or loop (format: JSHELL_TIMEFORMAT)\n"
     "\n\033[1;33mExamples:\033[0m\n"
     "  if true then echo yes else echo no fi\n"
     "  case $var in pattern1) cmd1 ;; *) cmd2 ;; esac\n"
@@ -130,9 +140,15 @@ int cmd_cd(command_t *cmd) {
 }
 
 // exit command
-int cmd_exit(command_t * __attribute__((unused)) cmd) {
-    exit(0);
-    return 0;
+int cmd_exit(command_t *cmd) {
+    int status = cmd->args[1] ? atoi(cmd->args[1]) : 0;
+    if (in_subshell) {
+        // Leave the parent's stdio streams (e.g. a script being read) alone.
+        fflush(stdout);
+        _exit(status);
+    }
+    exit(status);
+    return status;
 }
 
 // history command
@@ -165,7 +181,7 @@ int cmd_alias(command_t *cmd) {
             if (vlen > 0 && (value[0] == '\'' || value[0] == '"')) {
                 char quote = value[0];
                 // Copy the null terminator as well.
-                memmove(value, value + 1, strlen(value) + 1);
+                memmove(value, value + 1, strlen(value));
                 vlen = strlen(value);
                 if (vlen > 0 && value[vlen - 1] == quote)
                     value[vlen - 1] = '\0';
@@ -227,11 +243,7 @@ int cmd_fg(command_t *cmd) {
         int job_id = atoi(cmd->args[1] + 1);  // skip '%'
         pid_t pid = get_pid_by_job_id(job_id);
         if (pid > 0) {
-            fg_wait = 1;  // Set flag to prevent prompt
-            fg_process_done = 0;
-            print_prompt_pending = 0;  // Clear any pending prompts
             continue_job(pid, 1); // foreground
-            fg_wait = 0;  // Clear flag after job completes
         } else {
             fprintf(stderr, "fg: no such job\n");
         }
@@ -274,18 +286,12 @@ int cmd_kill(command_t *cmd) {
 int cmd_export(command_t *cmd) {
     if (cmd->args[1]) {
         // Reconstruct the full assignment from tokens 1..(arg_count-1)
-        int total_len = 0;
-        for (int i = 1; i < cmd->arg_count; i++) {
-            total_len += strlen(cmd->args[i]) + 1;  // plus space separator
-        }
-        char *assignment = malloc(total_len);
-        assignment[0] = '\0';
-        for (int i = 1; i < cmd->arg_count; i++) {
-            strcat(assignment, cmd->args[i]);
-            if (i < cmd->arg_count - 1)
-                strcat(assignment, " ");
+        char *assignment = command_join(NULL, cmd->args + 1);
+        if (!assignment) {
+            perror("export");
+            return 0;
         }
-        
+
         char *equals = strchr(assignment, '=');
         if (!equals) {
             fprintf(stderr, "export: invalid format (use VAR=value)\n");
@@ -307,6 +313,8 @@ int cmd_export(command_t *cmd) {
         
         if (setenv(var, value, 1) != 0)
             perror("export");
+        else if (strcmp(var, "PATH") == 0)
+            path_cache_clear();
         
         free(assignment);
     } else {
@@ -320,6 +328,8 @@ int cmd_unset(command_t *cmd) {
     if (cmd->args[1]) {
         if (unsetenv(cmd->args[1]) != 0)
             perror("unset");
+        else if (strcmp(cmd->args[1], "PATH") == 0)
+            path_cache_clear();
     } else {
         fprintf(stderr, "unset: missing variable name\n");
     }
@@ -333,3 +343,328 @@ int cmd_env(command_t * __attribute__((unused)) cmd) {
         printf("%s\n", *env);
     return 0;
 }
+
+// hash command: no args lists, -r clears, names pre-seed the table
+int cmd_hash(command_t *cmd) {
+    if (cmd->arg_count < 2) {
+        path_cache_list();
+        return 0;
+    }
+    int status = 0;
+    for (int i = 1; i < cmd->arg_count; i++) {
+        if (strcmp(cmd->args[i], "-r") == 0) {
+            path_cache_clear();
+        } else if (path_cache_seed(cmd->args[i]) != 0) {
+            fprintf(stderr, "hash: %s: not found\n", cmd->args[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// true / : commands
+int cmd_true(command_t *cmd) {
+    (void)cmd;
+    return 0;
+}
+
+// false command
+int cmd_false(command_t *cmd) {
+    (void)cmd;
+    return 1;
+}
+
+// pwd command
+int cmd_pwd(command_t *cmd) {
+    (void)cmd;
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        perror("pwd");
+        return 1;
+    }
+    printf("%s\n", cwd);
+    return 0;
+}
+
+// Writes the backslash escape starting at s (just after the '\') to out.
+// Returns the number of characters consumed, or -1 for \c (stop output).
+static int write_escape(const char *s, FILE *out, int octal_needs_zero) {
+    int used = 1;
+    switch (*s) {
+        case 'a': fputc('\a', out); break;
+        case 'b': fputc('\b', out); break;
+        case 'c': return -1;
+        case 'e': fputc('\033', out); break;
+        case 'f': fputc('\f', out); break;
+        case 'n': fputc('\n', out); break;
+        case 'r': fputc('\r', out); break;
+        case 't': fputc('\t', out); break;
+        case 'v': fputc('\v', out); break;
+        case '\\': fputc('\\', out); break;
+        case '0': case '1': case '2': case '3':
+        case '4': case '5': case '6': case '7': {
+            // echo/%b take \0NNN; the printf format takes \NNN.
+            const char *p = s;
+            if (octal_needs_zero) {
+                if (*p != '0') { fputc('\\', out); fputc(*s, out); break; }
+                p++;
+            }
+            int value = 0, digits = 0;
+            while (digits < 3 && *p >= '0' && *p <= '7') {
+                value = value * 8 + (*p++ - '0');
+                digits++;
+            }
+            fputc(value, out);
+            used = p - s;
+            break;
+        }
+        case '\0': fputc('\\', out); return 0;
+        default: fputc('\\', out); fputc(*s, out); break;
+    }
+    return used;
+}
+
+// Copies str to out interpreting escapes; returns 0, or -1 if \c was seen.
+static int write_escaped(const char *str, FILE *out, int octal_needs_zero) {
+    for (const char *p = str; *p; p++) {
+        if (*p != '\\') { fputc(*p, out); continue; }
+        int used = write_escape(p + 1, out, octal_needs_zero);
+        if (used < 0) return -1;
+        p += used;
+    }
+    return 0;
+}
+
+// Writes a finished memstream buffer straight to fd 1, normally in one
+// write(), so it lands in order with stderr and child output. Anything
+// still buffered in stdout goes first.
+static void flush_buffer(char *buf, size_t len) {
+    fflush(stdout);
+    for (size_t done = 0; done < len; ) {
+        ssize_t n = write(STDOUT_FILENO, buf + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += n;
+    }
+    free(buf);
+}
+
+// echo command: supports -n, -e and -E
+int cmd_echo(command_t *cmd) {
+    int newline = 1, escapes = 0, i = 1;
+    for (; i < cmd->arg_count; i++) {
+        const char *a = cmd->args[i];
+        if (a[0] != '-' || a[1] == '\0' || strspn(a + 1, "neE") != strlen(a + 1))
+            break;
+        for (const char *f = a + 1; *f; f++) {
+            if (*f == 'n') newline = 0;
+            else if (*f == 'e') escapes = 1;
+            else escapes = 0;
+        }
+    }
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&buf, &len);
+    if (!out) { perror("echo"); return 1; }
+    for (int first = i; i < cmd->arg_count; i++) {
+        if (i > first) fputc(' ', out);
+        if (escapes) {
+            if (write_escaped(cmd->args[i], out, 1) < 0) { newline = 0; break; }
+        } else {
+            fputs(cmd->args[i], out);
+        }
+    }
+    if (newline) fputc('\n', out);
+    fclose(out);
+    flush_buffer(buf, len);
+    return 0;
+}
+
+// Converts a printf numeric argument; 'c / "c give the character code.
+static int printf_number(const char *arg, long long *value) {
+    if (arg[0] == '\'' || arg[0] == '"') {
+        *value = (unsigned char)arg[1];
+        return 0;
+    }
+    char *end;
+    *value = strtoll(arg, &end, 0);
+    if (*arg == '\0') return 0;
+    if (*end != '\0') {
+        fprintf(stderr, "printf: %s: invalid number\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+// printf command: POSIX format with %s %b %c %d %i %u %o %x %X %e %f %g %%,
+// reusing the format while arguments remain. Output is one write per call.
+int cmd_printf(command_t *cmd) {
+    if (cmd->arg_count < 2) {
+        fprintf(stderr, "printf: usage: printf format [arguments]\n");
+        return 2;
+    }
+    const char *format = cmd->args[1];
+    int argi = 2, status = 0, stop = 0;
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&buf, &len);
+    if (!out) { perror("printf"); return 1; }
+    do {
+        int consumed = 0;
+        for (const char *p = format; *p && !stop; p++) {
+            if (*p == '\\') {
+                int used = write_escape(p + 1, out, 0);
+                if (used < 0) { stop = 1; break; }
+                p += used;
+                continue;
+            }
+            if (*p != '%') { fputc(*p, out); continue; }
+            if (p[1] == '%') { fputc('%', out); p++; continue; }
+            // Collect flags, width and precision into a conversion spec.
+            char spec[64] = "%";
+            size_t sl = 1;
+            const char *q = p + 1;
+            while (*q && strchr("-+ #0123456789.", *q) && sl < sizeof(spec) - 4)
+                spec[sl++] = *q++;
+            char conv = *q;
+            if (!conv) { fputc('%', out); break; }
+            const char *arg = (argi < cmd->arg_count) ? cmd->args[argi++] : NULL;
+            consumed = 1;
+            switch (conv) {
+                case 's':
+                    spec[sl++] = 's'; spec[sl] = '\0';
+                    fprintf(out, spec, arg ? arg : "");
+                    break;
+                case 'b':
+                    if (arg && write_escaped(arg, out, 1) < 0) stop = 1;
+                    break;
+                case 'c':
+                    if (arg && *arg) fputc(arg[0], out);
+                    break;
+                case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': {
+                    long long v = 0;
+                    if (arg && printf_number(arg, &v) < 0) status = 1;
+                    spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = '\0';
+                    fprintf(out, spec, v);
+                    break;
+                }
+                case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': {
+                    double v = 0;
+                    if (arg) {
+                        char *end;
+                        v = strtod(arg, &end);
+                        if (*end != '\0') {
+                            fprintf(stderr, "printf: %s: invalid number\n", arg);
+                            status = 1;
+                        }
+                    }
+                    spec[sl++] = conv; spec[sl] = '\0';
+                    fprintf(out, spec, v);
+                    break;
+                }
+                default:
+                    fprintf(stderr, "printf: %%%c: invalid directive\n", conv);
+                    argi--;
+                    status = 1;
+                    stop = 1;
+                    break;
+            }
+            p = q;
+        }
+        if (!consumed) break;
+    } while (!stop && argi < cmd->arg_count);
+    fclose(out);
+    flush_buffer(buf, len);
+    return status;
+}
+
+// sleep command: fractional seconds with optional s/m/h/d suffix
+int cmd_sleep(command_t *cmd) {
+    if (cmd->arg_count < 2) {
+        fprintf(stderr, "sleep: missing operand\n");
+        return 1;
+    }
+    double total = 0;
+    for (int i = 1; i < cmd->arg_count; i++) {
+        char *end;
+        double v = strtod(cmd->args[i], &end);
+        double scale = 1;
+        if (*end == 'm') { scale = 60; end++; }
+        else if (*end == 'h') { scale = 3600; end++; }
+        else if (*end == 'd') { scale = 86400; end++; }
+        else if (*end == 's') end++;
+        if (end == cmd->args[i] || *end != '\0' || v < 0) {
+            fprintf(stderr, "sleep: invalid time interval '%s'\n", cmd->args[i]);
+            return 1;
+        }
+        total += v * scale;
+    }
+    struct timespec req;
+    req.tv_sec = (time_t)total;
+    req.tv_nsec = (long)((total - (double)req.tv_sec) * 1e9);
+    sigint_received = 0;
+    // Resume after unrelated signals (e.g. SIGCHLD); stop on Ctrl+C.
+    while (nanosleep(&req, &req) < 0 && errno == EINTR) {
+        if (sigint_received) return 130;
+    }
+    return 0;
+}
+
+// set command: set -o / +o name, set -X / +X, or set -o alone to list
+int cmd_set(command_t *cmd) {
+    if (cmd->arg_count < 2 || (cmd->arg_count == 2 && strcmp(cmd->args[1], "-o") == 0)) {
+        list_shell_options();
+        return 0;
+    }
+    int status = 0;
+    for (int i = 1; i < cmd->arg_count; i++) {
+        const char *arg = cmd->args[i];
+        if (arg[0] != '-' && arg[0] != '+') {
+            fprintf(stderr, "set: %s: invalid option\n", arg);
+            return 2;
+        }
+        int value = (arg[0] == '-');
+        if (strcmp(arg + 1, "o") == 0) {
+            if (i + 1 >= cmd->arg_count) {
+                list_shell_options();
+                continue;
+            }
+            if (set_shell_option(cmd->args[++i], value) != 0) {
+                fprintf(stderr, "set: %s: invalid option name\n", cmd->args[i]);
+                status = 2;
+            }
+            continue;
+        }
+        for (const char *f = arg + 1; *f; f++) {
+            if (set_shell_flag(*f, value) != 0) {
+                fprintf(stderr, "set: %c%c: invalid option\n", arg[0], *f);
+                status = 2;
+            }
+        }
+    }
+    return status;
+}
+
+// wait command: starts every queued job and waits for background jobs
+int cmd_wait(command_t *cmd) {
+    (void)cmd;
+    job_manager_wait(0);
+    return 0;
+}
+
+// maxjobs command: shows or sets the background job slot limit
+int cmd_maxjobs(command_t *cmd) {
+    if (cmd->args[1]) {
+        char *endptr;
+        long limit = strtol(cmd->args[1], &endptr, 10);
+        if (*endptr != '\0' || limit < 0) {
+            fprintf(stderr, "maxjobs: numeric argument required\n");
+            return 1;
+        }
+        job_manager_set_limit((int)limit);
+        job_manager_reap(0);
+    } else {
+        printf("%d\n", job_manager_get_limit());
+    }
+    return 0;
+}
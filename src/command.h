@@ -10,7 +10,8 @@ typedef enum {
     CMD_SUBSHELL,
     CMD_AND,
     CMD_OR,
-    CMD_SEQUENCE
+    CMD_SEQUENCE,
+    CMD_TIME
 } command_type_t;
 
 typedef struct case_entry_t {
@@ -23,6 +24,7 @@ typedef struct command_t {
     char *command;
     char **args;
     int arg_count;
+    unsigned char *quoted_args;     // per arg, 1 if it was a quoted pattern; NULL if none
     char *input_file;
     char *output_file;
     int append_output;
@@ -30,20 +32,37 @@ typedef struct command_t {
     int last_status;
     struct command_t *next;
     int alias_expanded;
-    char *if_condition;
+    struct command_t *if_condition;
     struct command_t *then_branch;
     struct command_t *else_branch;
-    char *while_condition;
+    struct command_t *while_condition;
     struct command_t *while_body;
     char *for_variable;
     char **for_list;
+    unsigned char *for_quoted;      // per for_list item, 1 if it was a quoted range; NULL if none
     struct command_t *for_body;
     char *case_expression;
     case_entry_t **case_entries;
     int case_entry_count;
     struct command_t *subshell_cmd;
+    struct command_t *timed_cmd;    // body of a time keyword
+    struct arena_t *arena;          // arena holding this node and its strings
+    int arena_root;                 // set on the node that owns the arena
+    struct vm_program_t *program;   // compiled form, built on first run (vm.h)
 } command_t;
 
+// Frees a tree returned by parse_input() or command_copy() by dropping its
+// arena. Called on any other node it does nothing: that memory belongs to
+// the root's arena.
 void command_free(command_t *cmd);
+// Copies a tree, with its pipeline chain, into a new arena of its own so it
+// can outlive the line it was parsed from.
+command_t *command_copy(const command_t *cmd);
+// Copies s into cmd's arena, for fields set after parsing.
+char *command_strdup(command_t *cmd, const char *s);
+// Joins head (if non-NULL) and the NULL-terminated words with single spaces
+// into one malloc'd string sized in a first pass, so the cost stays linear
+// in the total length. Returns NULL if out of memory.
+char *command_join(const char *head, char *const *words);
 
 #endif
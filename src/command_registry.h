@@ -41,6 +41,15 @@ int register_command(const char *name, command_func_t func, const char *help);
  */
 const command_entry_t *lookup_command(const char *name);
 
+/**
+ * Runs a builtin in the shell process, applying cmd's redirections around it.
+ * @param entry Registry entry from lookup_command()
+ * @param cmd Command whose arguments are expanded and passed to the builtin
+ * @pre entry and cmd are non-NULL
+ * @post cmd->last_status holds the builtin's return value
+ */
+void execute_builtin(const command_entry_t *entry, command_t *cmd);
+
 /**
  * Lists all available commands with their descriptions.
  * @pre Command registry is initialized
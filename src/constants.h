@@ -3,12 +3,13 @@
 
 #include <limits.h>
 
+#define JSHELL_VERSION "1.0"
+
 #define SHELL_MAX_INPUT 4096
 #define MAX_CMD_LEN 4096
 #define MAX_PROMPT_LEN 4096
 #define MAX_PATH_LEN PATH_MAX
 
-#define MAX_ARGS 256
 #define MAX_HISTORY 1000
 #define MAX_BACKGROUND_PROCESSES 64
 
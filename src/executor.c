@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,19 +12,46 @@
 #include "alias.h"
 #include "command_registry.h"
 #include "job_manager.h"
+#include "spawn.h"
+#include "path_cache.h"
+#include "options.h"
+#include "timing.h"
+#include "xtrace.h"
+#include "arena.h"
+#include "script_cache.h"
+#include "script_reader.h"
+#include "vm.h"
 
 // Forward declarations
-static int evaluate_condition(const char *cond);
-static void execute_if_block(command_t *cmd);
-static void execute_while(command_t *cmd);
-static void execute_for(command_t *cmd);
 static char *trim_quotes(const char *str);
-static void execute_case(command_t *cmd);
 static command_t *merge_commands(command_t *old_cmd, command_t *new_cmd);
+static void run_subshell_body(command_t *cmd) __attribute__((noreturn));
 
 extern int num_background_processes;
 extern pid_t background_processes[];
 
+// Pipe capacity requested through JSHELL_PIPE_SIZE (bytes, k or m suffix);
+// 0 keeps the kernel default of 64 KiB.
+static long pipeline_pipe_size(void) {
+    const char *val = getenv("JSHELL_PIPE_SIZE");
+    if (!val || !*val) return 0;
+    char *end;
+    long size = strtol(val, &end, 10);
+    if (*end == 'k' || *end == 'K') size *= 1024;
+    else if (*end == 'm' || *end == 'M') size *= 1024 * 1024;
+    return size > 0 ? size : 0;
+}
+
+// Creates a close-on-exec pipe, sized for throughput mode when enabled.
+// Resizing is best effort: sizes above /proc/sys/fs/pipe-max-size are
+// refused for unprivileged users and the default capacity is kept.
+static int open_pipe(int fd[2]) {
+    if (pipe2(fd, O_CLOEXEC) == -1) return -1;
+    long size = pipeline_pipe_size();
+    if (size > 0) fcntl(fd[1], F_SETPIPE_SZ, (int)size);
+    return 0;
+}
+
 void execute_pipe(command_t *left, command_t *right) {
     command_t *left_cmd = left;
     command_t *right_cmd = right;
@@ -34,36 +62,36 @@ void execute_pipe(command_t *left, command_t *right) {
     char *right_alias = alias_get(right->args[0]);
     
     if (left_alias) {
-        char *expanded = malloc(SHELL_MAX_INPUT);
+        char *expanded = command_join(left_alias, left->args + 1);
         if (expanded) {
-            snprintf(expanded, SHELL_MAX_INPUT, "%s", left_alias);
-            for (int i = 1; left->args[i]; i++) {
-                strcat(expanded, " ");
-                strcat(expanded, left->args[i]);
-            }
             left_cmd = parse_input(expanded);
             free(expanded);
         }
     }
     
     if (right_alias) {
-        char *expanded = malloc(SHELL_MAX_INPUT);
+        char *expanded = command_join(right_alias, right->args + 1);
         if (expanded) {
-            snprintf(expanded, SHELL_MAX_INPUT, "%s", right_alias);
-            for (int i = 1; right->args[i]; i++) {
-                strcat(expanded, " ");
-                strcat(expanded, right->args[i]);
-            }
             right_cmd = parse_input(expanded);
             if (right_cmd) {
-                right_cmd->output_file = right->output_file ? strdup(right->output_file) : NULL;
+                right_cmd->output_file = command_strdup(right_cmd, right->output_file);
                 right_cmd->append_output = right->append_output;
             }
             free(expanded);
         }
     }
     
-    if (pipe(fd) == -1) {
+    char *left_path = NULL, *right_path = NULL;
+    if (left_cmd && left_cmd->args[0]) {
+        const char *p = path_cache_lookup(left_cmd->args[0]);
+        left_path = p ? strdup(p) : NULL;
+    }
+    if (right_cmd && right_cmd->args[0]) {
+        const char *p = path_cache_lookup(right_cmd->args[0]);
+        right_path = p ? strdup(p) : NULL;
+    }
+
+    if (open_pipe(fd) == -1) {
         perror("pipe error");
     } else {
         pipe_created = 1;
@@ -72,9 +100,11 @@ void execute_pipe(command_t *left, command_t *right) {
             close(fd[0]);
             dup2(fd[1], STDOUT_FILENO);
             close(fd[1]);
-            execvp(left_cmd->args[0], left_cmd->args);
-            perror("execvp left pipe");
-            exit(EXIT_FAILURE);
+            if (!left_path) {
+                fprintf(stderr, "%s: command not found\n", left_cmd->args[0] ? left_cmd->args[0] : "");
+                _exit(127);
+            }
+            exec_command(left_path, left_cmd->args);
         } else if (pid1 > 0) {
             pid_t pid2 = fork();
             if (pid2 == 0) {
@@ -89,9 +119,11 @@ void execute_pipe(command_t *left, command_t *right) {
                         close(fd_out);
                     }
                 }
-                execvp(right_cmd->args[0], right_cmd->args);
-                perror("execvp right pipe");
-                exit(EXIT_FAILURE);
+                if (!right_path) {
+                    fprintf(stderr, "%s: command not found\n", right_cmd->args[0] ? right_cmd->args[0] : "");
+                    _exit(127);
+                }
+                exec_command(right_path, right_cmd->args);
             } else if (pid2 > 0) {
                 close(fd[0]);
                 close(fd[1]);
@@ -101,6 +133,8 @@ void execute_pipe(command_t *left, command_t *right) {
         }
     }
     
+    free(left_path);
+    free(right_path);
     if (left_alias && left_cmd != left) {
         command_free(left_cmd);
     }
@@ -121,16 +155,17 @@ void continue_job(pid_t pid, int foreground) {
     if (foreground) {
         tcsetpgrp(STDIN_FILENO, pid);
         int status;
-        while (1) {
-            if (waitpid(pid, &status, WUNTRACED) < 0)
-                break;
-            if (WIFEXITED(status) || WIFSIGNALED(status) || WIFSTOPPED(status))
-                break;
+        if (job_manager_wait_pid(pid, &status, NULL) < 0) {
+            tcsetpgrp(STDIN_FILENO, getpgrp());
+            return;
         }
         tcsetpgrp(STDIN_FILENO, getpgrp());
         if (WIFSTOPPED(status)) {
+            job_manager_update_state(pid, JOB_STOPPED);
             const char *cmd_str = get_process_command(pid);
             printf("\n[%d] Stopped %s\n", get_job_number(pid), cmd_str);
+        } else {
+            job_manager_remove_job(pid);
         }
     }
 }
@@ -150,24 +185,20 @@ static int check_alias_expansion(command_t *cmd) {
         char *alias_cmd = alias_get(cmd->args[0]);
         if (alias_cmd && !is_recursive_alias(cmd->args[0], 0)) {
             char *trimmed_alias = trim_quotes(alias_cmd);
-            char *expanded = malloc(SHELL_MAX_INPUT);
-            strncpy(expanded, trimmed_alias, SHELL_MAX_INPUT - 1);
-            for (int i = 1; cmd->args[i]; i++) {
-                strcat(expanded, " ");
-                strcat(expanded, cmd->args[i]);
-            }
-            command_t *new_cmd = parse_input(expanded);
+            char *expanded = command_join(trimmed_alias, cmd->args + 1);
+            command_t *new_cmd = expanded ? parse_input(expanded) : NULL;
             free(expanded);
             free(trimmed_alias);
             if (new_cmd) {
                 if (!new_cmd->output_file && cmd->output_file) {
-                    new_cmd->output_file = strdup(cmd->output_file);
+                    new_cmd->output_file = command_strdup(new_cmd, cmd->output_file);
                     new_cmd->append_output = cmd->append_output;
                 }
                 if (!new_cmd->input_file && cmd->input_file)
-                    new_cmd->input_file = strdup(cmd->input_file);
+                    new_cmd->input_file = command_strdup(new_cmd, cmd->input_file);
                 new_cmd->background = cmd->background;
                 execute_command(new_cmd);
+                cmd->last_status = new_cmd->last_status;
                 command_free(new_cmd);
                 return 1;
             }
@@ -197,15 +228,20 @@ int is_recursive_alias(const char *cmd, int depth) {
 
 void list_jobs(void) {
     int count = 0;
-    job_t *job_list = job_manager_get_all_jobs(&count);
-    if (count == 0) {
+    job_t *job = job_manager_get_all_jobs(&count);
+    int queued = job_manager_queued_count();
+    if (count == 0 && queued == 0) {
         printf("No active jobs\n");
         return;
     }
-    for (int i = 0; i < count; i++) {
-        const char *state_str = (job_list[i].state == JOB_RUNNING) ? "Running" :
-                                  (job_list[i].state == JOB_STOPPED) ? "Stopped" : "Done";
-        printf("[%d] %s\t%s (pid: %d)\n", job_list[i].job_id, state_str, job_list[i].command, job_list[i].pid);
+    for (; job; job = job->next) {
+        const char *state_str = (job->state == JOB_RUNNING) ? "Running" :
+                                  (job->state == JOB_STOPPED) ? "Stopped" : "Done";
+        printf("[%d] %s\t%s (pid: %d)\n", job->job_id, state_str, job->command, job->pid);
+    }
+    if (queued > 0) {
+        printf("Queued (%d running, limit %d):\n", job_manager_running_count(), job_manager_get_limit());
+        job_manager_list_queued();
     }
 }
 
@@ -214,85 +250,67 @@ int is_script_file(const char *filename) {
     return len > 4 && strcmp(filename + len - 4, ".jsh") == 0;
 }
 
-int execute_script(const char *filename) {
-    FILE *script = fopen(filename, "r");
-    if (!script) {
-        perror("Failed to open script");
-        return -1;
-    }
-    char line[SHELL_MAX_INPUT];
-    int line_num = 0;
-    while (fgets(line, sizeof(line), script)) {
-        line_num++;
-        size_t len = strlen(line);
-        if (len > 0 && line[len-1] == '\n') line[len-1] = '\0';
-        if (line[0] == '\0' || line[0] == '#') continue;
-        command_t *cmd = parse_input(line);
-        if (cmd) {
-            execute_command(cmd);
-            command_free(cmd);
-        } else {
-            fprintf(stderr, "Script error at line %d: Failed to parse command\n", line_num);
+// Runs and frees one parsed script command; line_num is its first line.
+static void run_script_line(command_t *cmd, int line_num) {
+    if (cmd) {
+        if (vm_disassemble_only) {
+            printf("; line %d\n", line_num);
+            vm_disassemble(cmd, stdout);
         }
+        // Like sh -n, noexec cannot be turned off again from the script.
+        else if (!opt_noexec) execute_command(cmd);
+        command_free(cmd);
+    } else {
+        fprintf(stderr, "Script error at line %d: Failed to parse command\n", line_num);
     }
-    fclose(script);
-    return 0;
-}
-
-static int evaluate_condition(const char *cond) {
-    if (!cond || strlen(cond) == 0) return 0;
-    char *trimmed = strdup(cond);
-    int ret = system(trimmed);
-    free(trimmed);
-    return (ret == 0);
-}
-
-static void execute_if_block(command_t *cmd) {
-    if (evaluate_condition(cmd->if_condition))
-        execute_command(cmd->then_branch);
-    else if (cmd->else_branch)
-        execute_command(cmd->else_branch);
-}
-
-static void execute_while(command_t *cmd) {
-    while (evaluate_condition(cmd->while_condition))
-        execute_command(cmd->while_body);
 }
 
-static void execute_for(command_t *cmd) {
-    for (int i = 0; cmd->for_list && cmd->for_list[i] != NULL; i++) {
-        setenv(cmd->for_variable, cmd->for_list[i], 1);
-        execute_command(cmd->for_body);
+int execute_script(const char *filename) {
+    if (script_cache_enabled) {
+        script_image_t *image = script_image_open(filename);
+        if (!image) {
+            perror("Failed to open script");
+            return -1;
+        }
+        command_t *cmd;
+        int line_num;
+        while (script_image_next(image, &cmd, &line_num))
+            run_script_line(cmd, line_num);
+        script_image_close(image);
+        return 0;
+    }
+    script_reader_t *reader = script_reader_open(filename);
+    if (!reader) {
+        perror("Failed to open script");
+        return -1;
     }
+    char *text;
+    int line_num;
+    while ((text = script_reader_next(reader, &line_num)))
+        run_script_line(parse_input(text), line_num);
+    script_reader_close(reader);
+    return 0;
 }
 
 static command_t *expand_alias_for_pipeline(command_t *cmd) {
-    if (!cmd || !cmd->args[0]) return cmd;
+    if (!cmd || cmd->type != CMD_SIMPLE || !cmd->args || !cmd->args[0]) return cmd;
     if (cmd->alias_expanded) return cmd;
     char *alias_str = alias_get(cmd->args[0]);
     if (!alias_str || is_recursive_alias(cmd->args[0], 0))
         return cmd;
     char *trimmed = trim_quotes(alias_str);
-    char buffer[SHELL_MAX_INPUT] = {0};
-    snprintf(buffer, SHELL_MAX_INPUT, "%s", trimmed);
+    char *joined = command_join(trimmed, cmd->args + 1);
     free(trimmed);
-    for (int i = 1; cmd->args[i]; i++) {
-        strcat(buffer, " ");
-        strcat(buffer, cmd->args[i]);
-    }
-    command_t *expanded_cmd = parse_input(buffer);
+    if (!joined) return cmd;
+    command_t *expanded_cmd = parse_input(joined);
+    free(joined);
     if (expanded_cmd) {
         if (cmd->output_file) {
-            if (expanded_cmd->output_file)
-                free(expanded_cmd->output_file);
-            expanded_cmd->output_file = strdup(cmd->output_file);
+            expanded_cmd->output_file = command_strdup(expanded_cmd, cmd->output_file);
             expanded_cmd->append_output = cmd->append_output;
         }
-        if (cmd->input_file) {
-            if (expanded_cmd->input_file)
-                free(expanded_cmd->input_file);
-            expanded_cmd->input_file = strdup(cmd->input_file);
-        }
+        if (cmd->input_file)
+            expanded_cmd->input_file = command_strdup(expanded_cmd, cmd->input_file);
         expanded_cmd->background = cmd->background;
         command_t *chain = cmd->next;
         cmd->next = NULL;
@@ -304,25 +322,61 @@ static command_t *expand_alias_for_pipeline(command_t *cmd) {
 }
 
 static void execute_pipeline(command_t *cmd) {
+    if (cmd->background && !job_manager_claim_slot(cmd)) return;
     for (command_t **p = &cmd; *p != NULL; p = &((*p)->next))
         *p = expand_alias_for_pipeline(*p);
+    if (opt_xtrace) xtrace_pipeline(cmd);
     int n = 0;
     command_t *cur = cmd;
     while (cur) { n++; cur = cur->next; }
     if (n == 0) return;
     int pipes[n-1][2];
     for (int i = 0; i < n - 1; i++) {
-        if (pipe(pipes[i]) == -1) {
+        if (open_pipe(pipes[i]) == -1) {
             perror("pipe");
             return;
         }
     }
-    pid_t pids[n];
+    // Resolve every stage in the parent so the cache is shared across runs.
+    // Registry builtins run in the forked child without exec.
+    char *paths[n];
+    const command_entry_t *entries[n];
     cur = cmd;
     for (int i = 0; i < n; i++) {
+        entries[i] = NULL;
+        paths[i] = NULL;
+        if (cur->type == CMD_SIMPLE && cur->args[0]) {
+            entries[i] = lookup_command(cur->args[0]);
+            if (!entries[i]) {
+                const char *p = path_cache_lookup(cur->args[0]);
+                paths[i] = p ? strdup(p) : NULL;
+            }
+        }
+        cur = cur->next;
+    }
+    // lastpipe: a builtin final stage runs in the shell so cd/export stick.
+    int run_last_here = opt_lastpipe && !cmd->background && entries[n-1] != NULL;
+    int nforked = run_last_here ? n - 1 : n;
+    pid_t pids[n];
+    fflush(stdout);
+    cur = cmd;
+    for (int i = 0; i < nforked; i++) {
+        // Under xtrace, a close-on-exec pipe tells the parent when the
+        // stage has exec'd (EOF), for the fork->exec latency.
+        int exec_pipe[2] = { -1, -1 };
+        struct timespec forked, execed;
+        if (opt_xtrace) {
+            if (pipe2(exec_pipe, O_CLOEXEC) == -1) exec_pipe[0] = exec_pipe[1] = -1;
+            clock_gettime(CLOCK_MONOTONIC, &forked);
+        }
         pids[i] = fork();
-        if (pids[i] < 0) { perror("fork"); return; }
+        if (pids[i] < 0) {
+            perror("fork");
+            for (int j = 0; j < n; j++) free(paths[j]);
+            return;
+        }
         else if (pids[i] == 0) {
+            if (exec_pipe[0] >= 0) close(exec_pipe[0]);
             if (i > 0) dup2(pipes[i-1][0], STDIN_FILENO);
             if (i < n - 1) dup2(pipes[i][1], STDOUT_FILENO);
             for (int j = 0; j < n - 1; j++) { close(pipes[j][0]); close(pipes[j][1]); }
@@ -339,269 +393,412 @@ static void execute_pipeline(command_t *cmd) {
                 dup2(fd_out, STDOUT_FILENO);
                 close(fd_out);
             }
-            execvp(cur->args[0], cur->args);
-            perror("execvp pipeline");
-            exit(EXIT_FAILURE);
+            if (!paths[i] && exec_pipe[1] >= 0) close(exec_pipe[1]);
+            if (cur->type == CMD_SUBSHELL) {
+                reset_child_signals(NULL);
+                run_subshell_body(cur);
+            }
+            if (entries[i]) {
+                reset_child_signals(NULL);
+                job_control_enabled = 0;
+                in_subshell = 1;
+                char **argv = expand_command_args(cur, &cur->arg_count);
+                if (argv) cur->args = argv;
+                int status = entries[i]->func(cur);
+                fflush(stdout);
+                _exit(status);
+            }
+            if (!paths[i]) {
+                fprintf(stderr, "%s: command not found\n", cur->args[0] ? cur->args[0] : "");
+                _exit(127);
+            }
+            char **argv = expand_command_args(cur, NULL);
+            exec_command(paths[i], argv ? argv : cur->args);
+        }
+        const char *stage_name = cur->type == CMD_SUBSHELL ? "subshell" : cur->args[0];
+        timing_launch(pids[i], stage_name);
+        if (exec_pipe[0] >= 0) {
+            char byte;
+            close(exec_pipe[1]);
+            while (read(exec_pipe[0], &byte, 1) < 0 && errno == EINTR)
+                ;
+            close(exec_pipe[0]);
+            clock_gettime(CLOCK_MONOTONIC, &execed);
+            xtrace_launched(pids[i], stage_name, &forked, paths[i] ? &execed : NULL);
         }
         cur = cur->next;
     }
-    for (int i = 0; i < n - 1; i++) { close(pipes[i][0]); close(pipes[i][1]); }
+    for (int i = 0; i < n; i++) free(paths[i]);
+    for (int i = 0; i < n - 1; i++) {
+        if (!(run_last_here && i == n - 2)) close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+    if (run_last_here) {
+        int saved_in = dup(STDIN_FILENO);
+        if (n > 1) {
+            dup2(pipes[n-2][0], STDIN_FILENO);
+            close(pipes[n-2][0]);
+        }
+        execute_builtin(entries[n-1], cur);
+        dup2(saved_in, STDIN_FILENO);
+        close(saved_in);
+        cmd->last_status = cur->last_status;
+    }
     if (!cmd->background) {
         int status;
-        for (int i = 0; i < n; i++) {
-            if (waitpid(pids[i], &status, 0) > 0 && i == n-1) {
-                cmd->last_status = WIFEXITED(status) ? WEXITSTATUS(status) : status;
+        struct rusage usage;
+        for (int i = 0; i < nforked; i++) {
+            if (wait4(pids[i], &status, 0, &usage) > 0) {
+                timing_reaped(pids[i], &usage);
+                xtrace_reaped(pids[i], status);
+                if (i == n-1)
+                    cmd->last_status = WIFEXITED(status) ? WEXITSTATUS(status) : status;
             }
         }
     } else {
-        job_manager_add_job(pids[0], "pipeline", 1);
+        job_manager_add_job(pids[0], n > 1 ? "pipeline" : cmd->args[0], 1);
         printf("[%d] %d\n", get_job_number(pids[0]), pids[0]);
     }
 }
 
-void execute_command(command_t *cmd) {
-    if (!cmd) return;
-    if (cmd->type == CMD_AND || cmd->type == CMD_OR) {
-        execute_command(cmd->then_branch);
-        int last_status = cmd->then_branch->last_status;
-        if ((cmd->type == CMD_AND && last_status == 0) ||
-            (cmd->type == CMD_OR && last_status != 0)) {
-            execute_command(cmd->else_branch);
-            cmd->last_status = cmd->else_branch->last_status;
-        } else {
-            cmd->last_status = last_status;
-        }
+// Points fd at file for the duration of a builtin; returns the saved
+// descriptor (or -2 when there is nothing to redirect), -1 on error.
+static int redirect_builtin_fd(int fd, const char *file, int flags) {
+    if (!file) return -2;
+    int target = open(file, flags, 0644);
+    if (target < 0) { perror(file); return -1; }
+    int saved = dup(fd);
+    dup2(target, fd);
+    close(target);
+    return saved;
+}
+
+static void restore_builtin_fd(int fd, int saved) {
+    if (saved < 0) return;
+    dup2(saved, fd);
+    close(saved);
+}
+
+// Runs a registry builtin in the shell process. Redirections are applied
+// by temporarily dup'ing stdin/stdout, so no child is needed.
+void execute_builtin(const command_entry_t *entry, command_t *cmd) {
+    fflush(stdout);
+    int saved_out = redirect_builtin_fd(STDOUT_FILENO, cmd->output_file,
+                                        O_CREAT | O_WRONLY | (cmd->append_output ? O_APPEND : O_TRUNC));
+    if (saved_out == -1) { cmd->last_status = 1; return; }
+    int saved_in = redirect_builtin_fd(STDIN_FILENO, cmd->input_file, O_RDONLY);
+    if (saved_in == -1) {
+        restore_builtin_fd(STDOUT_FILENO, saved_out);
+        cmd->last_status = 1;
         return;
     }
-    if (cmd->type == CMD_SEQUENCE) {
-        execute_command(cmd->then_branch);
-        execute_command(cmd->else_branch);
+    // Builtins see $VAR and pattern arguments expanded, like external
+    // commands do.
+    int argc;
+    char **argv = expand_command_args(cmd, &argc);
+    if (argv) {
+        if (opt_xtrace) xtrace_command(argv, cmd);
+        char **saved_args = cmd->args;
+        int saved_count = cmd->arg_count;
+        cmd->args = argv;
+        cmd->arg_count = argc;
+        cmd->last_status = entry->func(cmd);
+        cmd->args = saved_args;
+        cmd->arg_count = saved_count;
+        free(argv);
+    } else {
+        perror("malloc");
+        cmd->last_status = 1;
+    }
+    // Unflushed output would come out after stderr and later children.
+    fflush(stdout);
+    restore_builtin_fd(STDOUT_FILENO, saved_out);
+    restore_builtin_fd(STDIN_FILENO, saved_in);
+}
+
+// Parent side of a launch: waits for a foreground child (recording its
+// status and suspension) or registers a background job. Restores the
+// signal mask saved by the caller before SIGCHLD was blocked.
+static void finish_launch(command_t *cmd, pid_t pid, const char *name, const sigset_t *prev) {
+    if (pid < 0) {
+        sigprocmask(SIG_SETMASK, prev, NULL);
+        perror("fork error");
         return;
     }
+    strncpy(current_command, name, MAX_CMD_LEN - 1);
+    current_command[MAX_CMD_LEN - 1] = '\0';
+    if (!cmd->background) {
+        set_foreground_pid(pid);
+        if (job_control_enabled) tcsetpgrp(STDIN_FILENO, pid);
+        int status = 0;
+        struct rusage usage;
+        timing_launch(pid, name);
+        if (job_manager_wait_pid(pid, &status, &usage) == pid) {
+            timing_reaped(pid, &usage);
+            xtrace_reaped(pid, status);
+        }
+        sigprocmask(SIG_SETMASK, prev, NULL);
+        cmd->last_status = (WIFEXITED(status)) ? WEXITSTATUS(status) :
+                            (WIFSIGNALED(status)) ? 128 + WTERMSIG(status) : 1;
+        if (job_control_enabled) tcsetpgrp(STDIN_FILENO, getpgrp());
+        set_foreground_pid(0);
+        if (WIFSTOPPED(status)) {
+            job_manager_add_job(pid, current_command, 0);
+            job_manager_update_state(pid, JOB_STOPPED);
+            printf("\n[%d] Suspended %s\n", get_job_number(pid), current_command);
+        }
+    } else {
+        job_manager_add_job(pid, current_command, 1);
+        sigprocmask(SIG_SETMASK, prev, NULL);
+        printf("[%d] %d\n", get_job_number(pid), pid);
+    }
+}
+
+// Child side of ( ... ): runs the group in this forked copy of jshell,
+// without exec, and exits with its status.
+static void run_subshell_body(command_t *cmd) {
+    job_control_enabled = 0;
+    in_subshell = 1;
+    execute_command(cmd->subshell_cmd);
+    fflush(stdout);
+    _exit(cmd->subshell_cmd ? cmd->subshell_cmd->last_status : 0);
+}
+
+static void execute_subshell(command_t *cmd) {
+    if (cmd->background && !job_manager_claim_slot(cmd)) return;
+    int new_pgroup = job_control_enabled || cmd->background;
+    sigset_t block, prev;
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, &prev);
+    fflush(stdout);
+    struct timespec forked;
+    if (opt_xtrace) {
+        xtrace_keyword("( ... )%s", cmd->background ? " &" : "");
+        clock_gettime(CLOCK_MONOTONIC, &forked);
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (new_pgroup) setpgid(0, 0);
+        reset_child_signals(&prev);
+        if (cmd->output_file) {
+            int flags = O_CREAT | O_WRONLY | (cmd->append_output ? O_APPEND : O_TRUNC);
+            int fd_out = open(cmd->output_file, flags, 0644);
+            if (fd_out < 0) { perror(cmd->output_file); _exit(EXIT_FAILURE); }
+            dup2(fd_out, STDOUT_FILENO);
+            close(fd_out);
+        }
+        if (cmd->input_file) {
+            int fd_in = open(cmd->input_file, O_RDONLY);
+            if (fd_in < 0) { perror(cmd->input_file); _exit(EXIT_FAILURE); }
+            dup2(fd_in, STDIN_FILENO);
+            close(fd_in);
+        }
+        run_subshell_body(cmd);
+    }
+    if (pid > 0 && new_pgroup) setpgid(pid, pid);
+    if (pid > 0 && opt_xtrace) xtrace_launched(pid, "subshell", &forked, NULL);
+    finish_launch(cmd, pid, "subshell", &prev);
+}
+
+// time keyword: runs the timed tree and reports per-stage and total usage.
+static void execute_time(command_t *cmd) {
+    int started = timing_begin();
+    execute_command(cmd->timed_cmd);
+    cmd->last_status = cmd->timed_cmd ? cmd->timed_cmd->last_status : 0;
+    if (started) timing_end();
+}
+
+// Compound commands run as compiled programs (vm.c); everything else is a
+// leaf executed here.
+void execute_command(command_t *cmd) {
+    if (!cmd) return;
     switch (cmd->type) {
         case CMD_IF:
-            execute_if_block(cmd);
-            return;
         case CMD_WHILE:
-            execute_while(cmd);
-            return;
         case CMD_FOR:
-            execute_for(cmd);
-            return;
         case CMD_CASE:
-            execute_case(cmd);
+        case CMD_AND:
+        case CMD_OR:
+        case CMD_SEQUENCE:
+            vm_execute(cmd);
+            return;
+        default:
+            execute_simple(cmd);
+            return;
+    }
+}
+
+void execute_simple(command_t *cmd) {
+    switch (cmd->type) {
+        case CMD_SUBSHELL:
+            if (cmd->next) execute_pipeline(cmd);
+            else execute_subshell(cmd);
+            return;
+        case CMD_TIME:
+            execute_time(cmd);
             return;
         default:
             break;
     }
     if (!cmd->args[0]) return;
-    const command_entry_t *entry = lookup_command(cmd->args[0]);
-    if (entry) {
-        entry->func(cmd);
+    if (cmd->next) {
+        execute_pipeline(cmd);
         return;
     }
-    if (cmd->next) {
+    const command_entry_t *entry = lookup_command(cmd->args[0]);
+    if (entry && cmd->background) {
+        // A backgrounded builtin runs as a one-stage pipeline in a child.
         execute_pipeline(cmd);
         return;
     }
+    if (entry) {
+        execute_builtin(entry, cmd);
+        return;
+    }
     if (check_alias_expansion(cmd)) return;
-    pid_t pid = fork();
-    if (pid == 0) {  // Child process
-        setpgid(0, 0);
-        signal(SIGINT, SIG_DFL);
-        signal(SIGQUIT, SIG_DFL);
-        signal(SIGTSTP, SIG_DFL);
-        signal(SIGTTIN, SIG_DFL);
-        signal(SIGTTOU, SIG_DFL);
-        signal(SIGCHLD, SIG_DFL);
-        
-        // NEW: Expand arguments at runtime.
-        for (int i = 0; i < cmd->arg_count; i++) {
-            if (cmd->args[i][0] == '$') {
-                char *val = getenv(cmd->args[i] + 1);
-                free(cmd->args[i]);
-                cmd->args[i] = val ? strdup(val) : strdup("");
-            }
-        }
-        
-        if (cmd->output_file != NULL) {
-            int flags = O_CREAT | O_WRONLY | (cmd->append_output ? O_APPEND : O_TRUNC);
-            int fd_out = open(cmd->output_file, flags, 0644);
-            if (fd_out < 0) { perror(cmd->output_file); exit(EXIT_FAILURE); }
-            dup2(fd_out, STDOUT_FILENO);
-            close(fd_out);
-        }
-        if (cmd->input_file != NULL) {
-            int fd_in = open(cmd->input_file, O_RDONLY);
-            if (fd_in < 0) { perror(cmd->input_file); exit(EXIT_FAILURE); }
-            dup2(fd_in, STDIN_FILENO);
-            close(fd_in);
-        }
-        if (execvp(cmd->args[0], cmd->args) == -1) {
-            fprintf(stderr, "%s: command not found\n", cmd->args[0]);
-            _exit(127);
-        }
-    } else if (pid > 0) {
-        setpgid(pid, pid);
-        strncpy(current_command, cmd->args[0], MAX_CMD_LEN - 1);
-        current_command[MAX_CMD_LEN - 1] = '\0';
-        if (!cmd->background) {
-            set_foreground_pid(pid);
-            tcsetpgrp(STDIN_FILENO, pid);
-            int status;
-            {
-                sigset_t block, prev;
-                sigemptyset(&block);
-                sigaddset(&block, SIGCHLD);
-                sigprocmask(SIG_BLOCK, &block, &prev);
-                waitpid(pid, &status, WUNTRACED);
-                sigprocmask(SIG_SETMASK, &prev, NULL);
-            }
-            cmd->last_status = (WIFEXITED(status)) ? WEXITSTATUS(status) :
-                                (WIFSIGNALED(status)) ? 128 + WTERMSIG(status) : 1;
-            tcsetpgrp(STDIN_FILENO, getpgrp());
-            set_foreground_pid(0);
-            if (WIFSTOPPED(status)) {
-                job_manager_add_job(pid, current_command, 0);
-                job_manager_update_state(pid, JOB_STOPPED);
-                printf("\n[%d] Suspended %s\n", get_job_number(pid), current_command);
-            }
-        } else {
-            job_manager_add_job(pid, current_command, 1);
-            printf("[%d] %d\n", get_job_number(pid), pid);
-        }
-    } else {
-        perror("fork error");
+    if (cmd->background && !job_manager_claim_slot(cmd)) return;
+    char **argv = expand_command_args(cmd, NULL);
+    if (!argv) { perror("malloc"); return; }
+    if (opt_xtrace) xtrace_command(argv, cmd);
+    const char *path = path_cache_lookup(argv[0]);
+    if (!path) {
+        fprintf(stderr, "%s: command not found\n", argv[0]);
+        cmd->last_status = 127;
+        free(argv);
+        return;
     }
+    // Job control (process groups, terminal handoff) only matters on a tty;
+    // background jobs still get their own group so kill %N can signal it.
+    int new_pgroup = job_control_enabled || cmd->background;
+    sigset_t block, prev;
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, &prev);
+    fflush(stdout);
+    struct timespec forked, execed;
+    if (opt_xtrace) clock_gettime(CLOCK_MONOTONIC, &forked);
+    pid_t pid = spawn_command(cmd, path, argv, new_pgroup, &prev);
+    if (pid > 0 && opt_xtrace) {
+        // posix_spawn returns once the child has exec'd (CLONE_VFORK).
+        clock_gettime(CLOCK_MONOTONIC, &execed);
+        xtrace_launched(pid, argv[0], &forked, &execed);
+    }
+    free(argv);
+    finish_launch(cmd, pid, cmd->args[0], &prev);
 }
 
-void sigchld_handler(int __attribute__((unused)) sig) {
-    pid_t pid;
-    int status;
-    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
-        job_t *job = job_manager_get_job_by_pid(pid);
-        if (!job) continue;
-        if (WIFCONTINUED(status))
-            job_manager_update_state(pid, JOB_RUNNING);
-        else if (WIFSTOPPED(status)) {
-            job_manager_update_state(pid, JOB_STOPPED);
-            printf("\r\033[K[%d] Suspended %s\n", job->job_id, job->command);
-        } else if (WIFSIGNALED(status)) {
-            if (job->background)
-                printf("\r\033[K[%d] Terminated %s\n", job->job_id, job->command);
-            job_manager_remove_job(pid);
-        } else if (WIFEXITED(status)) {
-            if (job->background)
-                printf("\r\033[K[%d] Done %s\n", job->job_id, job->command);
-            job_manager_remove_job(pid);
-        }
-    }
+static char **copy_strv(arena_t *arena, char **v, int n) {
+    char **copy = arena_alloc(arena, sizeof(char*) * (n + 1));
+    for (int i = 0; i < n; i++)
+        copy[i] = arena_strdup(arena, v[i]);
+    return copy;
 }
 
-static void free_command_fields(command_t *cmd) {
-    if (!cmd) return;
-    if (cmd->command) { free(cmd->command); cmd->command = NULL; }
-    if (cmd->args) {
-        for (int i = 0; i < cmd->arg_count; i++) {
-            free(cmd->args[i]);
-        }
-        free(cmd->args); cmd->args = NULL;
-    }
-    if (cmd->input_file) { free(cmd->input_file); cmd->input_file = NULL; }
-    if (cmd->output_file) { free(cmd->output_file); cmd->output_file = NULL; }
-    if (cmd->if_condition) { free(cmd->if_condition); cmd->if_condition = NULL; }
-    if (cmd->while_condition) { free(cmd->while_condition); cmd->while_condition = NULL; }
-    if (cmd->for_variable) { free(cmd->for_variable); cmd->for_variable = NULL; }
-    if (cmd->for_list) {
-        for (int i = 0; cmd->for_list[i] != NULL; i++) {
-            free(cmd->for_list[i]);
-        }
-        free(cmd->for_list); cmd->for_list = NULL;
-    }
+static unsigned char *copy_flags(arena_t *arena, const unsigned char *flags, int n) {
+    if (!flags) return NULL;
+    unsigned char *copy = arena_alloc(arena, n + 1);
+    if (copy) memcpy(copy, flags, n);
+    return copy;
 }
 
+// Moves the expansion's fields into old_cmd, copying them into old_cmd's
+// arena since new_cmd's arena is freed here.
 static command_t *merge_commands(command_t *old_cmd, command_t *new_cmd) {
-    free_command_fields(old_cmd);
-    old_cmd->command = new_cmd->command; new_cmd->command = NULL;
-    old_cmd->args = new_cmd->args;         new_cmd->args = NULL;
+    arena_t *arena = old_cmd->arena;
+    old_cmd->args = copy_strv(arena, new_cmd->args, new_cmd->arg_count);
     old_cmd->arg_count = new_cmd->arg_count;
-    old_cmd->input_file = new_cmd->input_file; new_cmd->input_file = NULL;
-    old_cmd->output_file = new_cmd->output_file; new_cmd->output_file = NULL;
+    old_cmd->quoted_args = copy_flags(arena, new_cmd->quoted_args, new_cmd->arg_count);
+    old_cmd->command = old_cmd->args[0];
+    old_cmd->input_file = arena_strdup(arena, new_cmd->input_file);
+    old_cmd->output_file = arena_strdup(arena, new_cmd->output_file);
     old_cmd->append_output = new_cmd->append_output;
     old_cmd->background = new_cmd->background;
-    free(new_cmd);
+    old_cmd->if_condition = NULL;
+    old_cmd->while_condition = NULL;
+    old_cmd->for_variable = NULL;
+    old_cmd->for_list = NULL;
+    old_cmd->for_quoted = NULL;
+    command_free(new_cmd);
     return old_cmd;
 }
 
-// Updated execute_case to perform runtime expansion of the case expression.
-static void execute_case(command_t *cmd) {
-    if (!cmd->case_expression || !cmd->case_entries) return;
-    
-    // Expand environment variable if the expression starts with '$'
-    char *expanded_expr;
-    if (cmd->case_expression[0] == '$') {
-        char *val = getenv(cmd->case_expression + 1);
-        expanded_expr = val ? strdup(val) : strdup("");
-    } else {
-        expanded_expr = strdup(cmd->case_expression);
-    }
-    
-    command_t *default_body = NULL;
-    for (int i = 0; i < cmd->case_entry_count; i++) {
-        case_entry_t *entry = cmd->case_entries[i];
-        if (strcmp(entry->pattern, "*") == 0)
-            default_body = entry->body;
-        else if (strcmp(expanded_expr, entry->pattern) == 0) {
-            if (entry->body)
-                execute_command(entry->body);
-            free(expanded_expr);
-            return;
-        }
-    }
-    free(expanded_expr);
-    if (default_body) execute_command(default_body);
+void command_free(command_t *cmd) {
+    if (cmd && cmd->arena_root) arena_destroy(cmd->arena);
 }
 
-void command_free(command_t *cmd) {
-    if (!cmd) return;
-    if (cmd->command) free(cmd->command);
-    if (cmd->args) {
-        for (int i = 0; i < cmd->arg_count; i++) {
-            free(cmd->args[i]);
-        }
-        free(cmd->args);
-    }
-    if (cmd->input_file) free(cmd->input_file);
-    if (cmd->output_file) free(cmd->output_file);
-    if (cmd->if_condition) free(cmd->if_condition);
-    if (cmd->then_branch) command_free(cmd->then_branch);
-    if (cmd->else_branch) command_free(cmd->else_branch);
-    if (cmd->while_condition) free(cmd->while_condition);
-    if (cmd->while_body) command_free(cmd->while_body);
-    if (cmd->for_variable) free(cmd->for_variable);
+char *command_strdup(command_t *cmd, const char *s) {
+    return arena_strdup(cmd->arena, s);
+}
+
+char *command_join(const char *head, char *const *words) {
+    size_t total = head ? strlen(head) + 1 : 1;
+    for (char *const *w = words; *w; w++) total += strlen(*w) + 1;
+    char *joined = malloc(total);
+    if (!joined) return NULL;
+    char *end = joined;
+    if (head) {
+        size_t n = strlen(head);
+        memcpy(end, head, n);
+        end += n;
+    }
+    for (char *const *w = words; *w; w++) {
+        if (head || w > words) *end++ = ' ';
+        size_t n = strlen(*w);
+        memcpy(end, *w, n);
+        end += n;
+    }
+    *end = '\0';
+    return joined;
+}
+
+static command_t *copy_node(arena_t *arena, const command_t *cmd) {
+    if (!cmd) return NULL;
+    command_t *copy = arena_alloc(arena, sizeof(command_t));
+    memcpy(copy, cmd, sizeof(command_t));
+    copy->arena = arena;
+    copy->arena_root = 0;
+    copy->program = NULL;
+    copy->command = arena_strdup(arena, cmd->command);
+    if (cmd->args) copy->args = copy_strv(arena, cmd->args, cmd->arg_count);
+    copy->quoted_args = copy_flags(arena, cmd->quoted_args, cmd->arg_count);
+    copy->input_file = arena_strdup(arena, cmd->input_file);
+    copy->output_file = arena_strdup(arena, cmd->output_file);
+    copy->next = copy_node(arena, cmd->next);
+    copy->if_condition = copy_node(arena, cmd->if_condition);
+    copy->then_branch = copy_node(arena, cmd->then_branch);
+    copy->else_branch = copy_node(arena, cmd->else_branch);
+    copy->while_condition = copy_node(arena, cmd->while_condition);
+    copy->while_body = copy_node(arena, cmd->while_body);
+    copy->for_variable = arena_strdup(arena, cmd->for_variable);
     if (cmd->for_list) {
-        for (int i = 0; cmd->for_list[i]; i++) {
-            free(cmd->for_list[i]);
-        }
-        free(cmd->for_list);
-    }
-    if (cmd->for_body) command_free(cmd->for_body);
-    if (cmd->type == CMD_SUBSHELL && cmd->subshell_cmd) {
-        command_free(cmd->subshell_cmd);
+        int n = 0;
+        while (cmd->for_list[n]) n++;
+        copy->for_list = copy_strv(arena, cmd->for_list, n);
+        copy->for_quoted = copy_flags(arena, cmd->for_quoted, n);
     }
-    if (cmd->case_expression) free(cmd->case_expression);
+    copy->for_body = copy_node(arena, cmd->for_body);
+    copy->case_expression = arena_strdup(arena, cmd->case_expression);
     if (cmd->case_entries) {
+        copy->case_entries = arena_alloc(arena, sizeof(case_entry_t*) * cmd->case_entry_count);
         for (int i = 0; i < cmd->case_entry_count; i++) {
-            if (cmd->case_entries[i]) {
-                if (cmd->case_entries[i]->pattern) 
-                    free(cmd->case_entries[i]->pattern);
-                if (cmd->case_entries[i]->body)
-                    command_free(cmd->case_entries[i]->body);
-                free(cmd->case_entries[i]);
-            }
+            case_entry_t *entry = arena_alloc(arena, sizeof(case_entry_t));
+            entry->pattern = arena_strdup(arena, cmd->case_entries[i]->pattern);
+            entry->body = copy_node(arena, cmd->case_entries[i]->body);
+            copy->case_entries[i] = entry;
         }
-        free(cmd->case_entries);
     }
-    if (cmd->next) command_free(cmd->next);
-    free(cmd);
+    copy->subshell_cmd = copy_node(arena, cmd->subshell_cmd);
+    copy->timed_cmd = copy_node(arena, cmd->timed_cmd);
+    return copy;
+}
+
+// Deep-copies a command tree, including its pipeline chain.
+command_t *command_copy(const command_t *cmd) {
+    if (!cmd) return NULL;
+    arena_t *arena = arena_create();
+    if (!arena) return NULL;
+    command_t *copy = copy_node(arena, cmd);
+    copy->arena_root = 1;
+    return copy;
 }
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "glob.h"
+
+// How a pattern component is matched against directory entries.
+typedef enum {
+    MATCH_ANY,      // "*"
+    MATCH_SUFFIX,   // "*.ext"
+    MATCH_PREFIX,   // "name*"
+    MATCH_PATTERN   // anything else, through glob_match()
+} match_kind_t;
+
+typedef struct {
+    match_kind_t kind;
+    const char *pattern;
+    const char *literal;    // fixed part for MATCH_SUFFIX / MATCH_PREFIX
+    size_t literal_len;
+    int dot;                // pattern starts with '.', so hidden names may match
+} matcher_t;
+
+// The path built up while walking pattern components.
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} path_buf_t;
+
+typedef struct {
+    glob_matches_t *out;
+    path_buf_t path;
+} walk_t;
+
+// A '[' only starts a pattern when a ']' follows, so "[" as in the test
+// builtin never costs a directory read.
+static int has_magic(const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '*' || s[i] == '?') return 1;
+        if (s[i] == '[' && memchr(s + i + 1, ']', len - i - 1)) return 1;
+    }
+    return 0;
+}
+
+int glob_has_magic(const char *word) {
+    return has_magic(word, strlen(word));
+}
+
+// Matches c against the bracket expression after a '['. Returns the
+// pattern just past the closing ']' and sets *hit, or NULL if the bracket
+// is never closed (the '[' is then literal).
+static const char *match_class(const char *p, unsigned char c, int *hit) {
+    int negate = *p == '!' || *p == '^';
+    if (negate) p++;
+    const char *start = p;
+    int found = 0;
+    // A ']' first in the set is a member, not the end.
+    while (*p && (*p != ']' || p == start)) {
+        unsigned char lo = *p;
+        if (lo == '\\' && p[1]) lo = *++p;
+        p++;
+        unsigned char hi = lo;
+        if (*p == '-' && p[1] && p[1] != ']') {
+            p++;
+            if (*p == '\\' && p[1]) p++;
+            hi = *p++;
+        }
+        if (lo <= c && c <= hi) found = 1;
+    }
+    if (*p != ']') return NULL;
+    *hit = found != negate;
+    return p + 1;
+}
+
+int glob_match(const char *pattern, const char *name) {
+    const char *p = pattern;
+    const char *n = name;
+    // Where to resume after the last '*' when a later character mismatches.
+    const char *star_p = NULL;
+    const char *star_n = NULL;
+    while (*n) {
+        if (*p == '*') {
+            star_p = ++p;
+            star_n = n;
+            continue;
+        }
+        if (*p == '?') {
+            p++;
+            n++;
+            continue;
+        }
+        if (*p == '[') {
+            int hit = 0;
+            const char *next = match_class(p + 1, (unsigned char)*n, &hit);
+            if (next && hit) {
+                p = next;
+                n++;
+                continue;
+            }
+            if (!next && *n == '[') {
+                p++;
+                n++;
+                continue;
+            }
+        } else {
+            const char *lit = (*p == '\\' && p[1]) ? p + 1 : p;
+            if (*lit && *lit == *n) {
+                p = lit + 1;
+                n++;
+                continue;
+            }
+        }
+        if (!star_p) return 0;
+        p = star_p;
+        n = ++star_n;
+    }
+    while (*p == '*') p++;
+    return *p == '\0';
+}
+
+static void compile_matcher(matcher_t *m, const char *pattern) {
+    size_t len = strlen(pattern);
+    m->pattern = pattern;
+    m->dot = pattern[0] == '.';
+    m->kind = MATCH_PATTERN;
+    m->literal = NULL;
+    m->literal_len = 0;
+    if (strchr(pattern, '\\')) return;
+    if (pattern[0] == '*' && !has_magic(pattern + 1, len - 1)) {
+        m->kind = len == 1 ? MATCH_ANY : MATCH_SUFFIX;
+        m->literal = pattern + 1;
+        m->literal_len = len - 1;
+    } else if (len > 1 && pattern[len - 1] == '*' && !has_magic(pattern, len - 1)) {
+        m->kind = MATCH_PREFIX;
+        m->literal = pattern;
+        m->literal_len = len - 1;
+    }
+}
+
+static int matcher_accepts(const matcher_t *m, const char *name, size_t len) {
+    if (name[0] == '.' && !m->dot) return 0;
+    switch (m->kind) {
+        case MATCH_ANY:
+            return 1;
+        case MATCH_SUFFIX:
+            return len >= m->literal_len &&
+                   memcmp(name + len - m->literal_len, m->literal, m->literal_len) == 0;
+        case MATCH_PREFIX:
+            return len >= m->literal_len && memcmp(name, m->literal, m->literal_len) == 0;
+        default:
+            return glob_match(m->pattern, name);
+    }
+}
+
+static int path_append(path_buf_t *p, const char *s, size_t n) {
+    if (p->len + n + 1 > p->cap) {
+        size_t cap = p->cap ? p->cap * 2 : 256;
+        while (cap < p->len + n + 1) cap *= 2;
+        char *grown = realloc(p->data, cap);
+        if (!grown) return -1;
+        p->data = grown;
+        p->cap = cap;
+    }
+    memcpy(p->data + p->len, s, n);
+    p->len += n;
+    p->data[p->len] = '\0';
+    return 0;
+}
+
+// Appends a literal component with its backslash escapes removed.
+static int path_append_unescaped(path_buf_t *p, const char *s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == '\\' && i + 1 < n) i++;
+        if (path_append(p, s + i, 1) < 0) return -1;
+    }
+    return 0;
+}
+
+static void path_truncate(path_buf_t *p, size_t len) {
+    p->len = len;
+    if (p->data) p->data[len] = '\0';
+}
+
+static void add_match(glob_matches_t *m, const char *path, size_t len) {
+    if (m->failed) return;
+    if (m->count == m->cap) {
+        size_t cap = m->cap ? m->cap * 2 : 16;
+        size_t *grown = realloc(m->offsets, sizeof(size_t) * cap);
+        if (!grown) { m->failed = 1; return; }
+        m->offsets = grown;
+        m->cap = cap;
+    }
+    if (m->pool_len + len + 1 > m->pool_cap) {
+        size_t cap = m->pool_cap ? m->pool_cap * 2 : 4096;
+        while (cap < m->pool_len + len + 1) cap *= 2;
+        char *grown = realloc(m->pool, cap);
+        if (!grown) { m->failed = 1; return; }
+        m->pool = grown;
+        m->pool_cap = cap;
+    }
+    m->offsets[m->count++] = m->pool_len;
+    memcpy(m->pool + m->pool_len, path, len + 1);
+    m->pool_len += len + 1;
+}
+
+// d_type settles most entries; symlinks and DT_UNKNOWN need a stat().
+static int entry_is_dir(const struct dirent *d, const char *path) {
+    if (d->d_type == DT_DIR) return 1;
+    if (d->d_type != DT_LNK && d->d_type != DT_UNKNOWN) return 0;
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static size_t slash_run(const char *s) {
+    size_t n = 0;
+    while (s[n] == '/') n++;
+    return n;
+}
+
+static void walk(walk_t *w, const char *rest);
+
+// Appends the literal components at the front of *rest to w->path without
+// reading their directories. Returns 1 if the pattern ends among them,
+// after recording the path if it exists, or 0 with *rest at the first
+// component that has a pattern character.
+static int append_literals(walk_t *w, const char **rest) {
+    for (;;) {
+        const char *slash = strchr(*rest, '/');
+        size_t len = slash ? (size_t)(slash - *rest) : strlen(*rest);
+        if (has_magic(*rest, len)) return 0;
+        if (path_append_unescaped(&w->path, *rest, len) < 0) return 1;
+        struct stat st;
+        if (!slash) {
+            if (lstat(w->path.data, &st) == 0)
+                add_match(w->out, w->path.data, w->path.len);
+            return 1;
+        }
+        size_t slashes = slash_run(slash);
+        if (path_append(&w->path, slash, slashes) < 0) return 1;
+        *rest = slash + slashes;
+        if (!**rest) {
+            if (stat(w->path.data, &st) == 0 && S_ISDIR(st.st_mode))
+                add_match(w->out, w->path.data, w->path.len);
+            return 1;
+        }
+    }
+}
+
+// Reads the directory in w->path and matches its entries against the
+// first component of rest, descending for the components after it.
+static void walk_dir(walk_t *w, const char *rest) {
+    const char *slash = strchr(rest, '/');
+    char *component = slash ? strndup(rest, slash - rest) : strdup(rest);
+    if (!component) return;
+    matcher_t m;
+    compile_matcher(&m, component);
+    size_t dir_len = w->path.len;
+    DIR *dir = opendir(dir_len ? w->path.data : ".");
+    if (dir) {
+        struct dirent *d;
+        while ((d = readdir(dir)) != NULL) {
+            const char *name = d->d_name;
+            if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) continue;
+            size_t name_len = strlen(name);
+            if (!matcher_accepts(&m, name, name_len)) continue;
+            path_truncate(&w->path, dir_len);
+            if (path_append(&w->path, name, name_len) < 0) break;
+            if (!slash) {
+                add_match(w->out, w->path.data, w->path.len);
+                continue;
+            }
+            if (!entry_is_dir(d, w->path.data)) continue;
+            size_t slashes = slash_run(slash);
+            if (path_append(&w->path, slash, slashes) < 0) break;
+            if (slash[slashes]) walk(w, slash + slashes);
+            else add_match(w->out, w->path.data, w->path.len);
+        }
+        closedir(dir);
+    }
+    free(component);
+}
+
+// Expands the components in rest below the directory in w->path, which is
+// restored before returning.
+static void walk(walk_t *w, const char *rest) {
+    size_t base = w->path.len;
+    if (!append_literals(w, &rest)) walk_dir(w, rest);
+    path_truncate(&w->path, base);
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+size_t glob_expand(const char *pattern, glob_matches_t *out) {
+    size_t first = out->count;
+    walk_t w = { out, { NULL, 0, 0 } };
+    size_t root = slash_run(pattern);
+    if (path_append(&w.path, pattern, root) == 0) walk(&w, pattern + root);
+    free(w.path.data);
+    size_t n = out->count - first;
+    if (n > 1 && !out->failed) {
+        // Sort pointers, then rewrite the offsets in that order.
+        char **paths = malloc(sizeof(char*) * n);
+        if (!paths) {
+            out->failed = 1;
+            return n;
+        }
+        for (size_t i = 0; i < n; i++) paths[i] = out->pool + out->offsets[first + i];
+        qsort(paths, n, sizeof(char*), compare_paths);
+        for (size_t i = 0; i < n; i++) out->offsets[first + i] = paths[i] - out->pool;
+        free(paths);
+    }
+    return n;
+}
+
+const char *glob_match_at(const glob_matches_t *m, size_t i) {
+    return m->pool + m->offsets[i];
+}
+
+void glob_matches_free(glob_matches_t *m) {
+    free(m->pool);
+    free(m->offsets);
+    memset(m, 0, sizeof(*m));
+}
@@ -0,0 +1,70 @@
+#ifndef GLOB_H
+#define GLOB_H
+
+#include <stddef.h>
+
+// Pathname expansion for *, ? and [...] in command words. Directories are
+// read with readdir() and classified by d_type, so only symlinks and file
+// systems that leave d_type unset cost a stat(). Components shaped like
+// "*", "*.ext" or "name*" skip the general matcher.
+
+// Matches appended by glob_expand(): NUL-terminated paths stored back to
+// back in one pool, so a million matches are not a million mallocs.
+typedef struct {
+    char *pool;
+    size_t pool_len;
+    size_t pool_cap;
+    size_t *offsets;    // start of each match in pool
+    size_t count;
+    size_t cap;
+    int failed;         // an allocation failed; later appends are dropped
+} glob_matches_t;
+
+/**
+ * Tells whether a word contains a pattern character: *, ?, or a [ with a
+ * ] after it.
+ * @param word Word to check
+ * @return 1 if the word should go through glob_expand()
+ * @pre word is a non-NULL string
+ */
+int glob_has_magic(const char *word);
+
+/**
+ * Matches one name against a pattern with no '/' in it. A backslash makes
+ * the next character literal; a '[' without a closing ']' is literal.
+ * @param pattern Pattern of *, ?, [abc], [a-z] and [!x] (or [^x])
+ * @param name Name to test
+ * @return 1 on a match, 0 otherwise
+ * @pre pattern and name are non-NULL strings
+ */
+int glob_match(const char *pattern, const char *name);
+
+/**
+ * Expands a pattern against the file system and appends the matching
+ * paths, sorted in byte order. Wildcards only match a leading '.' when
+ * the pattern component starts with one, and never match "." or "..".
+ * A trailing '/' restricts matches to directories.
+ * @param pattern Pattern, relative or absolute
+ * @param out Matches to append to, zeroed before first use
+ * @return Number of paths appended (0 if nothing matched)
+ * @pre pattern and out are non-NULL
+ * @post Paths appended are readable with glob_match_at()
+ */
+size_t glob_expand(const char *pattern, glob_matches_t *out);
+
+/**
+ * Returns one appended path.
+ * @param m Matches from glob_expand()
+ * @param i Index below m->count
+ * @return Path, valid until the next glob_expand() or glob_matches_free()
+ */
+const char *glob_match_at(const glob_matches_t *m, size_t i);
+
+/**
+ * Frees the pool and offsets.
+ * @param m Matches to release, may be empty
+ * @post m is zeroed and can be reused
+ */
+void glob_matches_free(glob_matches_t *m);
+
+#endif
@@ -6,6 +6,13 @@
 
 static char *history_list[MAX_HISTORY];
 static int history_count = 0;
+static int history_loaded = 0;
+
+// The history file is read the first time history is consulted (arrow
+// keys, the history builtin, tab fallback, saving), not at startup.
+static void history_ensure_loaded(void) {
+    if (!history_loaded) history_load();
+}
 
 void history_init(void) {
     memset(history_list, 0, sizeof(history_list));
@@ -19,6 +26,7 @@ void history_add(const char *line) {
 }
 
 char *history_find_match(const char *prefix) {
+    history_ensure_loaded();
     size_t len = strlen(prefix);
     for (int i = 0; i < history_count; i++) {
         if (strncmp(history_list[i], prefix, len) == 0) {
@@ -29,6 +37,9 @@ char *history_find_match(const char *prefix) {
 }
 
 void history_save(void) {
+    // Nothing typed and nothing read: leave the file alone.
+    if (!history_loaded && history_count == 0) return;
+    history_ensure_loaded();
     char *home = getenv("HOME");
     if (!home) return;
 
@@ -47,6 +58,8 @@ void history_save(void) {
 }
 
 void history_load(void) {
+    if (history_loaded) return;
+    history_loaded = 1;
     char *home = getenv("HOME");
     if (!home) return;
 
@@ -56,6 +69,12 @@ void history_load(void) {
     FILE *fp = fopen(history_path, "r");
     if (!fp) return;
 
+    // Lines added before the load go after the ones from the file.
+    char *pending[MAX_HISTORY];
+    int pending_count = history_count;
+    memcpy(pending, history_list, sizeof(char *) * pending_count);
+    history_count = 0;
+
     char line[SHELL_MAX_INPUT];
     while (fgets(line, sizeof(line), fp)) {
         size_t len = strlen(line);
@@ -65,6 +84,10 @@ void history_load(void) {
         history_add(line);
     }
     fclose(fp);
+    for (int i = 0; i < pending_count; i++) {
+        if (history_count < MAX_HISTORY) history_list[history_count++] = pending[i];
+        else free(pending[i]);
+    }
 }
 
 void history_cleanup(void) {
@@ -76,6 +99,7 @@ void history_cleanup(void) {
 }
 
 char *history_get(int index) {
+    history_ensure_loaded();
     if (index >= 0 && index < history_count) {
         return history_list[index];
     }
@@ -83,6 +107,7 @@ char *history_get(int index) {
 }
 
 int history_size(void) {
+    history_ensure_loaded();
     return history_count;
 }
 
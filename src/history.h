@@ -57,8 +57,10 @@ void history_save(void);
 
 /**
  * Loads the command history from disk.
+ * Called on first use by the other history functions; later calls do nothing.
  * @pre History system is initialized
- * @post Previous history is loaded from HISTORY_FILE if it exists
+ * @post Previous history is loaded from HISTORY_FILE if it exists, ahead
+ *       of any lines added before the load
  */
 void history_load(void);
 
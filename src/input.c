@@ -6,9 +6,12 @@
 #include <dirent.h>
 #include <errno.h>
 #include <ctype.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include "shell.h"
 #include "history.h"
+#include "job_manager.h"
+#include "jobs_signals.h"
 
 extern char current_input_buffer[];
 extern int current_input_length;
@@ -110,6 +113,42 @@ char **get_path_completions(const char *path, int *count) {
 
 static volatile int input_interrupted = 0;  // global flag
 
+// Reprints the prompt and the line being edited after a job notification.
+static void redraw_line(const char *buffer, int pos, int cursor) {
+    print_prompt();
+    printf("%.*s", pos, buffer);
+    if (cursor < pos) printf("\033[%dD", pos - cursor);
+    fflush(stdout);
+}
+
+// Reads one byte of input, polling the SIGCHLD self-pipe alongside the
+// terminal so finished jobs are reaped and reported while the user types.
+static int read_key(const char *buffer, int pos, int cursor) {
+    struct pollfd fds[2] = {
+        { STDIN_FILENO, POLLIN, 0 },
+        { jobs_signal_fd(), POLLIN, 0 }
+    };
+    int nfds = fds[1].fd >= 0 ? 2 : 1;
+    // read() bypasses stdio, so nothing else flushes the prompt or echo.
+    fflush(stdout);
+    while (1) {
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (nfds == 2 && (fds[1].revents & POLLIN) && jobs_signals_drain()) {
+            if (job_manager_reap(0) > 0) redraw_line(buffer, pos, cursor);
+        }
+        if (fds[0].revents) {
+            unsigned char c;
+            ssize_t n = read(STDIN_FILENO, &c, 1);
+            if (n == 1) return c;
+            if (n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+    }
+}
+
 char *read_input() {
     struct termios oldt, newt;
     tcgetattr(STDIN_FILENO, &oldt);
@@ -126,11 +165,11 @@ char *read_input() {
     int cursor = 0;
     int pos = 0;
     int c;
-    int hist_index = history_size();
+    int hist_index = -1;    // -1 until the first arrow key loads history
 
     while (1) {
-        c = getchar();
-        
+        c = read_key(buffer, pos, cursor);
+
         if (c == -1) {
             if (errno == EINTR) {
                 continue;
@@ -234,10 +273,11 @@ char *read_input() {
             }
             fflush(stdout);
         } else if (c == 27) {
-            int next = getchar();
+            int next = read_key(buffer, pos, cursor);
             if (next == '[') {
-                int arrow = getchar();
+                int arrow = read_key(buffer, pos, cursor);
                 if (arrow == 'A' || arrow == 'B') {
+                    if (hist_index < 0) hist_index = history_size();
                     while (cursor < pos) {
                         printf("\033[C");
                         cursor++;
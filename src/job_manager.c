@@ -1,32 +1,121 @@
 #include "job_manager.h"
+#include "xtrace.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <errno.h>
 
-#define MAX_JOBS 128
+#define JOB_BUCKETS_MIN 64
 
-static job_t jobs[MAX_JOBS];
+// Jobs live on the heap and are linked three ways: a launch-ordered list
+// for listing, and one hash chain each for pid and job id lookups. Nothing
+// ever moves, so job_t pointers stay valid until the job is removed.
+static job_t *job_head = NULL;
+static job_t *job_tail = NULL;
+static job_t **pid_buckets = NULL;
+static job_t **id_buckets = NULL;
+static size_t bucket_count = 0;     // power of two
 static int num_jobs = 0;
+static int num_running = 0;         // background jobs in JOB_RUNNING
 static int next_job_id = 1;
 
+typedef struct queued_job {
+    int queue_id;
+    command_t *cmd;
+    struct queued_job *next;
+} queued_job_t;
+
+static queued_job_t *queue_head = NULL;
+static queued_job_t *queue_tail = NULL;
+static int num_queued = 0;
+static int next_queue_id = 1;
+static int limit_override = 0;
+static int launching_queued = 0;
+
+static size_t bucket_of(int key) {
+    return ((unsigned int)key * 2654435761u) & (bucket_count - 1);
+}
+
+static void count_running(const job_t *job, int delta) {
+    if (job->background && job->state == JOB_RUNNING)
+        num_running += delta;
+}
+
+// Doubles both hash tables once they are as full as they are wide.
+static int grow_buckets(void) {
+    size_t count = bucket_count ? bucket_count * 2 : JOB_BUCKETS_MIN;
+    job_t **pids = calloc(count, sizeof(job_t *));
+    job_t **ids = calloc(count, sizeof(job_t *));
+    if (!pids || !ids) {
+        free(pids);
+        free(ids);
+        return -1;
+    }
+    free(pid_buckets);
+    free(id_buckets);
+    pid_buckets = pids;
+    id_buckets = ids;
+    bucket_count = count;
+    for (job_t *job = job_head; job; job = job->next) {
+        size_t b = bucket_of(job->pid);
+        job->pid_chain = pid_buckets[b];
+        pid_buckets[b] = job;
+        b = bucket_of(job->job_id);
+        job->id_chain = id_buckets[b];
+        id_buckets[b] = job;
+    }
+    return 0;
+}
+
 // Updated job_manager_add_job with background flag:
 void job_manager_add_job(pid_t pid, const char *command, int background) {
-    if (num_jobs < MAX_JOBS) {
-        job_t new_job;
-        new_job.job_id = next_job_id++;
-        new_job.pid = pid;
-        strncpy(new_job.command, command, MAX_CMD_LEN - 1);
-        new_job.command[MAX_CMD_LEN - 1] = '\0';
-        new_job.state = JOB_RUNNING;
-        new_job.background = background;
-        jobs[num_jobs++] = new_job;
+    if ((size_t)num_jobs >= bucket_count && grow_buckets() < 0)
+        return;
+    job_t *job = malloc(sizeof(job_t));
+    char *copy = strdup(command);
+    if (!job || !copy) {
+        free(job);
+        free(copy);
+        return;
     }
+    job->job_id = next_job_id++;
+    job->pid = pid;
+    job->command = copy;
+    job->state = JOB_RUNNING;
+    job->background = background;
+    job->prev = job_tail;
+    job->next = NULL;
+    if (job_tail) job_tail->next = job;
+    else job_head = job;
+    job_tail = job;
+    size_t b = bucket_of(pid);
+    job->pid_chain = pid_buckets[b];
+    pid_buckets[b] = job;
+    b = bucket_of(job->job_id);
+    job->id_chain = id_buckets[b];
+    id_buckets[b] = job;
+    num_jobs++;
+    count_running(job, 1);
 }
 
 job_t *job_manager_get_job_by_pid(pid_t pid) {
-    for (int i = 0; i < num_jobs; i++) {
-        if (jobs[i].pid == pid)
-            return &jobs[i];
+    if (!bucket_count) return NULL;
+    for (job_t *job = pid_buckets[bucket_of(pid)]; job; job = job->pid_chain) {
+        if (job->pid == pid)
+            return job;
+    }
+    return NULL;
+}
+
+job_t *job_manager_get_job_by_id(int job_id) {
+    if (!bucket_count) return NULL;
+    for (job_t *job = id_buckets[bucket_of(job_id)]; job; job = job->id_chain) {
+        if (job->job_id == job_id)
+            return job;
     }
     return NULL;
 }
@@ -34,27 +123,172 @@ job_t *job_manager_get_job_by_pid(pid_t pid) {
 void job_manager_update_state(pid_t pid, job_state_t state) {
     job_t *job = job_manager_get_job_by_pid(pid);
     if (job) {
+        count_running(job, -1);
         job->state = state;
+        count_running(job, 1);
     }
 }
 
 void job_manager_remove_job(pid_t pid) {
-    int index = -1;
-    for (int i = 0; i < num_jobs; i++) {
-        if (jobs[i].pid == pid) {
-            index = i;
-            break;
-        }
+    job_t *job = NULL;
+    if (bucket_count) {
+        job_t **link = &pid_buckets[bucket_of(pid)];
+        while (*link && (*link)->pid != pid) link = &(*link)->pid_chain;
+        job = *link;
+        if (job) *link = job->pid_chain;
     }
-    if (index != -1) {
-        for (int i = index; i < num_jobs - 1; i++) {
-            jobs[i] = jobs[i + 1];
-        }
+    if (job) {
+        job_t **link = &id_buckets[bucket_of(job->job_id)];
+        while (*link != job) link = &(*link)->id_chain;
+        *link = job->id_chain;
+        if (job->prev) job->prev->next = job->next;
+        else job_head = job->next;
+        if (job->next) job->next->prev = job->prev;
+        else job_tail = job->prev;
         num_jobs--;
+        count_running(job, -1);
+        free(job->command);
+        free(job);
     }
 }
 
 job_t *job_manager_get_all_jobs(int *count) {
     if (count) *count = num_jobs;
-    return jobs;
+    return job_head;
+}
+
+void job_manager_set_limit(int limit) {
+    limit_override = limit > 0 ? limit : 0;
+}
+
+int job_manager_get_limit(void) {
+    int limit = limit_override;
+    if (limit <= 0) {
+        const char *env = getenv("JSHELL_MAX_JOBS");
+        if (env) limit = atoi(env);
+    }
+    if (limit <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        limit = cpus > 0 ? (int)cpus : 1;
+    }
+    return limit;
+}
+
+int job_manager_running_count(void) {
+    return num_running;
+}
+
+int job_manager_queued_count(void) {
+    return num_queued;
+}
+
+static const char *queued_label(const command_t *cmd) {
+    if (cmd->next) return "pipeline";
+    if (cmd->type == CMD_SUBSHELL) return "subshell";
+    return (cmd->args && cmd->args[0]) ? cmd->args[0] : "";
+}
+
+// Freezes $VAR arguments of each pipeline stage at queue time, so that a
+// loop like "for i in ... do work $i & done" queues the value it saw.
+static void expand_queued_args(command_t *cmd) {
+    for (; cmd; cmd = cmd->next) {
+        if (cmd->type != CMD_SIMPLE || !cmd->args) continue;
+        for (int i = 0; i < cmd->arg_count; i++) {
+            if (cmd->args[i][0] != '$') continue;
+            char *val = getenv(cmd->args[i] + 1);
+            cmd->args[i] = command_strdup(cmd, val ? val : "");
+        }
+    }
+}
+
+static void start_queued(void) {
+    while (queue_head && job_manager_running_count() < job_manager_get_limit()) {
+        queued_job_t *q = queue_head;
+        queue_head = q->next;
+        if (!queue_head) queue_tail = NULL;
+        num_queued--;
+        launching_queued = 1;
+        execute_command(q->cmd);
+        launching_queued = 0;
+        command_free(q->cmd);
+        free(q);
+    }
+}
+
+int job_manager_claim_slot(command_t *cmd) {
+    if (launching_queued) return 1;
+    job_manager_reap(0);
+    if (!queue_head && job_manager_running_count() < job_manager_get_limit())
+        return 1;
+    queued_job_t *q = malloc(sizeof(queued_job_t));
+    q->queue_id = next_queue_id++;
+    q->cmd = command_copy(cmd);
+    q->next = NULL;
+    expand_queued_args(q->cmd);
+    if (queue_tail) queue_tail->next = q;
+    else queue_head = q;
+    queue_tail = q;
+    num_queued++;
+    if (job_control_enabled)
+        printf("[Q%d] Queued %s\n", q->queue_id, queued_label(q->cmd));
+    return 0;
+}
+
+// Applies one waitpid() result to the job table and reports it.
+static void note_status(pid_t pid, int status) {
+    xtrace_reaped(pid, status);
+    job_t *job = job_manager_get_job_by_pid(pid);
+    if (!job) return;
+    if (WIFCONTINUED(status)) {
+        job_manager_update_state(pid, JOB_RUNNING);
+    } else if (WIFSTOPPED(status)) {
+        job_manager_update_state(pid, JOB_STOPPED);
+        if (job_control_enabled)
+            printf("\r\033[K[%d] Suspended %s\n", job->job_id, job->command);
+    } else {
+        if (job->background && job_control_enabled)
+            printf("\r\033[K[%d] Done %s\n", job->job_id, job->command);
+        job_manager_remove_job(pid);
+    }
+}
+
+int job_manager_reap(int block) {
+    int reaped = 0;
+    int flags = WUNTRACED | WCONTINUED | (block ? 0 : WNOHANG);
+    pid_t pid;
+    int status;
+    while ((pid = waitpid(-1, &status, flags)) > 0) {
+        reaped++;
+        flags |= WNOHANG;
+        note_status(pid, status);
+    }
+    start_queued();
+    return reaped;
+}
+
+pid_t job_manager_wait_pid(pid_t pid, int *status, struct rusage *usage) {
+    struct rusage scratch;
+    if (!usage) usage = &scratch;
+    for (;;) {
+        pid_t got = wait4(-1, status, WUNTRACED, usage);
+        if (got == pid) return got;
+        if (got > 0) {
+            note_status(got, *status);
+        } else if (errno != EINTR) {
+            // Not our child after all (e.g. already reaped); wait on it directly.
+            return wait4(pid, status, WUNTRACED, usage);
+        }
+    }
+}
+
+void job_manager_wait(int queued_only) {
+    while (queue_head || (!queued_only && job_manager_running_count() > 0)) {
+        if (job_manager_reap(1) == 0 && !queue_head)
+            break;
+    }
+}
+
+void job_manager_list_queued(void) {
+    for (queued_job_t *q = queue_head; q; q = q->next)
+        printf("[Q%d] Queued\t%s\n", q->queue_id, queued_label(q->cmd));
 }
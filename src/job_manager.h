@@ -2,7 +2,8 @@
 #define JOB_MANAGER_H
 
 #include <sys/types.h>
-#include "shell.h"  // for MAX_CMD_LEN
+#include <sys/resource.h>
+#include "shell.h"
 
 typedef enum {
     JOB_RUNNING,
@@ -13,17 +14,42 @@ typedef enum {
 typedef struct job {
     int job_id;
     pid_t pid;
-    char command[MAX_CMD_LEN];
+    char *command;
     job_state_t state;
     int background; // 1 if background job, 0 if foreground suspended
+    struct job *prev, *next;    // launch order
+    struct job *pid_chain;      // pid hash bucket
+    struct job *id_chain;       // job id hash bucket
 } job_t;
 
 // Updated: Add background flag parameter.
 void job_manager_add_job(pid_t pid, const char *command, int background);
 job_t *job_manager_get_job_by_pid(pid_t pid);
+job_t *job_manager_get_job_by_id(int job_id);
 void job_manager_update_state(pid_t pid, job_state_t state);
 void job_manager_remove_job(pid_t pid);
-// New function to obtain the job list
+// Returns the oldest job (walk ->next for the rest) and the job count.
 job_t *job_manager_get_all_jobs(int *count);
 
+// Background job slots. The limit comes from the maxjobs builtin, else
+// JSHELL_MAX_JOBS, else the online CPU count. Launches past the limit
+// are queued (with $VAR arguments expanded) and started as slots free up.
+
+// Returns 1 if cmd may launch now, 0 if a copy of it was queued instead.
+int job_manager_claim_slot(command_t *cmd);
+// Collects finished children and starts queued jobs; returns number reaped.
+// Runs in normal context only: the SIGCHLD handler just wakes its caller.
+int job_manager_reap(int block);
+// Waits for pid (exit or stop), handling other children that change state
+// meanwhile so background notifications are not held back. pid's resource
+// usage is stored in usage when it is non-NULL.
+pid_t job_manager_wait_pid(pid_t pid, int *status, struct rusage *usage);
+// Waits until the queue is empty, and for all running jobs unless queued_only.
+void job_manager_wait(int queued_only);
+void job_manager_set_limit(int limit);   // 0 restores the default
+int job_manager_get_limit(void);
+int job_manager_running_count(void);
+int job_manager_queued_count(void);
+void job_manager_list_queued(void);
+
 #endif
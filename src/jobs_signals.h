@@ -0,0 +1,29 @@
+#ifndef JOBS_SIGNALS_H
+#define JOBS_SIGNALS_H
+
+/**
+ * Installs the SIGCHLD handler and its self-pipe.
+ * The handler only writes a byte to the pipe; reaping and job
+ * notifications happen in normal context when the pipe is drained.
+ * @post SIGCHLD wakes up anything polling jobs_signal_fd()
+ */
+void init_jobs_signals(void);
+
+/**
+ * Restores the previous SIGCHLD disposition and closes the self-pipe.
+ */
+void cleanup_jobs_signals(void);
+
+/**
+ * Returns the read end of the SIGCHLD self-pipe, for poll().
+ * @return File descriptor, or -1 if init_jobs_signals() was not called
+ */
+int jobs_signal_fd(void);
+
+/**
+ * Empties the self-pipe without blocking.
+ * @return 1 if any SIGCHLD arrived since the last drain, 0 otherwise
+ */
+int jobs_signals_drain(void);
+
+#endif
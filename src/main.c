@@ -6,6 +6,7 @@
 #include <signal.h>
 #include <termios.h>
 #include <errno.h>
+#include <time.h>
 
 // Project headers
 #include "shell.h"
@@ -13,9 +14,12 @@
 #include "builtin_commands.h"
 #include "command_registry.h"
 #include "job_manager.h"
+#include "jobs_signals.h"
+#include "arena.h"
+#include "script_cache.h"
+#include "vm.h"
 
 // Signal handlers
-static void sigchld_handler(int);
 static void sigint_handler(int);
 static void sigterm_handler(int);
 static void sigtstp_handler(int);
@@ -28,8 +32,13 @@ int current_input_length = 0;
 static volatile int exiting = 0;
 volatile int in_input = 0;  
 pid_t foreground_pid = 0;
-volatile int fg_wait = 0, print_prompt_pending = 0, fg_process_done = 0;
 int command_mode = 0;
+static int startup_profile = 0;
+static struct timespec phase_start;
+static struct timespec profile_begin;
+int job_control_enabled = 0;
+int in_subshell = 0;
+volatile sig_atomic_t sigint_received = 0;
 
 void print_prompt(void) {
     char cwd[PATH_MAX];
@@ -52,10 +61,9 @@ void print_prompt(void) {
 static void set_signal_handlers() {
     struct sigaction sa;
     sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
-    sa.sa_handler = sigchld_handler;
-    sigaction(SIGCHLD, &sa, NULL);
-    
+    sa.sa_flags = SA_RESTART;
+    init_jobs_signals();
+
     sa.sa_handler = sigint_handler;
     sigaction(SIGINT, &sa, NULL);
     
@@ -69,12 +77,10 @@ static void set_signal_handlers() {
 
 void cleanup_background_processes(void) {
     exiting = 1;
-    int count = 0;
-    job_t *job_list = job_manager_get_all_jobs(&count);
-    for (int i = 0; i < count; i++) {
-        pid_t pid = job_list[i].pid;
-        kill(-pid, SIGTERM);
-        waitpid(pid, NULL, 0);
+    for (job_t *job = job_manager_get_all_jobs(NULL); job; job = job->next) {
+        kill(-job->pid, SIGTERM);
+        kill(-job->pid, SIGCONT);  // a stopped job cannot act on SIGTERM
+        waitpid(job->pid, NULL, 0);
     }
 }
 
@@ -84,13 +90,8 @@ int get_job_number(pid_t pid) {
 }
 
 int get_pid_by_job_id(int job_id) {
-    int count = 0;
-    job_t *job_list = job_manager_get_all_jobs(&count);
-    for (int i = 0; i < count; i++) {
-        if (job_list[i].job_id == job_id)
-            return job_list[i].pid;
-    }
-    return -1;
+    job_t *job = job_manager_get_job_by_id(job_id);
+    return job ? job->pid : -1;
 }
 
 char *get_process_command(pid_t pid) {
@@ -98,44 +99,8 @@ char *get_process_command(pid_t pid) {
     return job ? job->command : "unknown";
 }
 
-static void sigchld_handler(int __attribute__((unused)) sig) {
-    pid_t pid;
-    int status;
-    char saved_input[SHELL_MAX_INPUT];
-    size_t saved_cursor = (size_t)current_cursor_pos;
-    strncpy(saved_input, current_input_buffer, SHELL_MAX_INPUT);
-    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
-        job_t *job = job_manager_get_job_by_pid(pid);
-        if (job) {
-            if (WIFSTOPPED(status)) {
-                job_manager_update_state(pid, JOB_STOPPED);
-                printf("\r\033[K[%d] Suspended %s\n", job->job_id, job->command);
-                print_prompt_pending = 1;
-            } else if (WIFSIGNALED(status) || WIFEXITED(status)) {
-                if (pid == foreground_pid) fg_process_done = 1;
-                else {
-                    printf("\r\033[K[%d] Done %s\n", job->job_id, job->command);
-                    print_prompt_pending = 1;
-                }
-                job_manager_remove_job(pid);
-            }
-        }
-    }
-    if (print_prompt_pending && !fg_wait) {
-        if (in_input) {
-            print_prompt();
-            printf("%s", saved_input);
-            if (saved_cursor < strlen(saved_input))
-                printf("\033[%luD", strlen(saved_input) - saved_cursor);
-        } else {
-            print_prompt();
-        }
-        fflush(stdout);
-        print_prompt_pending = 0;
-    }
-}
-
 static void sigint_handler(int __attribute__((unused)) sig) {
+    sigint_received = 1;
     if (foreground_pid > 0) {
         kill(-foreground_pid, SIGINT);
         printf("\r\033[KTerminated\n");
@@ -167,12 +132,64 @@ static void sigtstp_handler(int __attribute__((unused)) sig) {
 
 void set_foreground_pid(pid_t pid) { foreground_pid = pid; }
 
+// --startup-profile: records the time spent in each shell_init phase;
+// the report is printed once init is done so printing is not measured.
+static struct { const char *phase; double us; } profile[8];
+static int profile_count = 0;
+
+static double us_since(const struct timespec *start, const struct timespec *now) {
+    return (now->tv_sec - start->tv_sec) * 1e6 + (now->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static void profile_phase(const char *phase) {
+    if (!startup_profile || profile_count == 8) return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    profile[profile_count].phase = phase;
+    profile[profile_count++].us = us_since(&phase_start, &now);
+    phase_start = now;
+}
+
+static void profile_report(void) {
+    if (!startup_profile) return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (int i = 0; i < profile_count; i++)
+        fprintf(stderr, "startup-profile: %-12s %9.1f us\n", profile[i].phase, profile[i].us);
+    fprintf(stderr, "startup-profile: %-12s %9.1f us\n", "total", us_since(&profile_begin, &now));
+}
+
+// --alloc-stats: parse allocation counters, printed at exit.
+static void alloc_stats_report(void) {
+    arena_report(parsed_line_count());
+}
+
 static void sigterm_handler(int __attribute__((unused)) sig) {
     cleanup_background_processes();
     exit(EXIT_SUCCESS);
 }
 
 int main(int argc, char *argv[]) {
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+        if (strcmp(argv[1], "--startup-profile") == 0) {
+            startup_profile = 1;
+            clock_gettime(CLOCK_MONOTONIC, &phase_start);
+            profile_begin = phase_start;
+        } else if (strcmp(argv[1], "--alloc-stats") == 0) {
+            atexit(alloc_stats_report);
+        } else if (strcmp(argv[1], "--no-script-cache") == 0) {
+            script_cache_enabled = 0;
+        } else if (strcmp(argv[1], "--script-cache-stats") == 0) {
+            atexit(script_cache_report);
+        } else if (strcmp(argv[1], "--disassemble") == 0) {
+            vm_disassemble_only = 1;
+        } else {
+            break;
+        }
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
     signal(SIGTERM, sigterm_handler);
     if (argc > 1 && strcmp(argv[1], "-c") == 0) command_mode = 1;
     shell_init();
@@ -184,10 +201,16 @@ int main(int argc, char *argv[]) {
                 exit(EXIT_FAILURE);
             }
             command_t *cmd = parse_input(argv[2]);
-            if (cmd) {
+            if (cmd && vm_disassemble_only) {
+                vm_disassemble(cmd, stdout);
+                command_free(cmd);
+                shell_cleanup();
+                exit(EXIT_SUCCESS);
+            } else if (cmd) {
                 execute_command(cmd);
                 int exit_status = cmd->last_status;
                 command_free(cmd);
+                job_manager_wait(1);
                 shell_cleanup();
                 exit(exit_status);
             } else {
@@ -196,7 +219,10 @@ int main(int argc, char *argv[]) {
                 exit(EXIT_FAILURE);
             }
         } else if (is_script_file(argv[1])) {
-            return execute_script(argv[1]);
+            int result = execute_script(argv[1]);
+            // Launch whatever is still waiting for a job slot.
+            job_manager_wait(1);
+            return result;
         } else {
             fprintf(stderr, "Error: Unrecognized option or file '%s'\n", argv[1]);
             shell_cleanup();
@@ -210,6 +236,7 @@ int main(int argc, char *argv[]) {
 
 void shell_init(void) {
     if (isatty(STDIN_FILENO)) {
+        job_control_enabled = 1;
         pid_t shell_pgid = getpid();
         while (tcgetpgrp(STDIN_FILENO) != (shell_pgid = getpgrp()))
             kill(-shell_pgid, SIGTTIN);
@@ -219,23 +246,32 @@ void shell_init(void) {
         signal(SIGTTIN, SIG_IGN);
         signal(SIGTTOU, SIG_IGN);
         shell_pgid = getpid();
-        if (setpgid(shell_pgid, shell_pgid) < 0) {
+        // A session leader (e.g. started directly on a new pty) already
+        // leads its group and may not call setpgid.
+        if (getpgrp() != shell_pgid && setpgid(shell_pgid, shell_pgid) < 0) {
             perror("Couldn't put the shell in its own process group");
             exit(1);
         }
         tcsetpgrp(STDIN_FILENO, shell_pgid);
         set_signal_handlers();
     }
-    setenv("SHELL_NAME", "jshell", 1);
+    profile_phase("job-control");
     history_init();
-    history_load();
+    profile_phase("history");
     alias_init();
     init_command_registry();
     register_builtin_commands();
+    profile_phase("registry");
+    // Exports and aliases apply in every mode; the interactive-only work
+    // (history, the prompt) is already deferred until it is used.
     load_rc_file();
+    profile_phase("rc");
+    setenv("SHELL_NAME", "jshell", 1);
     if (!getenv("PATH")) {
         setenv("PATH", "/usr/local/bin:/usr/bin:/bin:/usr/sbin:/sbin", 1);
     }
+    profile_phase("environment");
+    profile_report();
     if (!command_mode) printf("Welcome to JShell! Type 'help' for available commands.\n");
 }
 
@@ -245,6 +281,7 @@ void shell_cleanup(void) {
     alias_cleanup();
     cleanup_command_registry();
     cleanup_background_processes();
+    cleanup_jobs_signals();
     tcsetpgrp(STDIN_FILENO, getpgrp());
     if (!command_mode) printf("\nGoodbye!\n");
 }
@@ -254,6 +291,8 @@ void shell_loop(void) {
     command_t *cmd;
     int status = 1;
     while (status && !exiting) {
+        // Children that changed state while a command ran are reaped here.
+        if (jobs_signals_drain()) job_manager_reap(0);
         print_prompt();
         current_input_length = 0;
         current_input_buffer[0] = '\0';
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <string.h>
+#include "options.h"
+
+int opt_lastpipe = 0;
+int opt_xtrace = 0;
+int opt_noexec = 0;
+int opt_noglob = 0;
+int opt_nullglob = 0;
+
+typedef struct {
+    const char *name;
+    char letter;        // 0 if the option has no short flag
+    int *flag;
+} shell_option_t;
+
+static const shell_option_t options[] = {
+    { "lastpipe", 0, &opt_lastpipe },
+    { "xtrace",   'x', &opt_xtrace },
+    { "noexec",   'n', &opt_noexec },
+    { "noglob",   'f', &opt_noglob },
+    { "nullglob", 0, &opt_nullglob },
+};
+
+#define OPTION_COUNT (int)(sizeof(options) / sizeof(options[0]))
+
+int set_shell_option(const char *name, int value) {
+    for (int i = 0; i < OPTION_COUNT; i++) {
+        if (strcmp(options[i].name, name) == 0) {
+            *options[i].flag = value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int set_shell_flag(char letter, int value) {
+    for (int i = 0; i < OPTION_COUNT; i++) {
+        if (options[i].letter && options[i].letter == letter) {
+            *options[i].flag = value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void list_shell_options(void) {
+    for (int i = 0; i < OPTION_COUNT; i++)
+        printf("%-15s %s\n", options[i].name, *options[i].flag ? "on" : "off");
+}
@@ -0,0 +1,38 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+// Shell options, toggled with the set builtin
+extern int opt_lastpipe;    // run a builtin last pipeline stage in the shell
+extern int opt_xtrace;      // set -x: trace commands and child latencies
+extern int opt_noexec;      // set -n: scripts are parsed but not run
+extern int opt_noglob;      // set -f: words are not expanded as file patterns
+extern int opt_nullglob;    // patterns that match nothing expand to no words
+
+/**
+ * Enables or disables a shell option by long name (set -o / set +o).
+ * @param name Option name, e.g. "lastpipe"
+ * @param value 1 to enable, 0 to disable
+ * @return 0 on success, -1 if the option is unknown
+ * @pre name is a non-NULL string
+ * @post Option flag is updated
+ */
+int set_shell_option(const char *name, int value);
+
+/**
+ * Enables or disables a shell option by its single-letter flag (set -x).
+ * @param letter Option letter
+ * @param value 1 to enable, 0 to disable
+ * @return 0 on success, -1 if no option uses that letter
+ * @pre None
+ * @post Option flag is updated
+ */
+int set_shell_flag(char letter, int value);
+
+/**
+ * Prints every option and whether it is on.
+ * @pre None
+ * @post Option states are printed to stdout
+ */
+void list_shell_options(void);
+
+#endif
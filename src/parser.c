@@ -4,101 +4,404 @@
 #include <ctype.h>
 #include "shell.h"
 #include "command.h"
+#include "arena.h"
+#include "brace.h"
 
-// Tokenizes the input into an array of tokens.
-static char **tokenize(const char *input, int *count) {
-    char **tokens = malloc(sizeof(char*) * 256);
+// Arena of the parse in progress. Tokens, nodes and strings all come from
+// it, so AST strings can point straight at their tokens.
+static arena_t *arena;
+static unsigned long lines_parsed = 0;
+static unsigned long parse_errors = 0;
+int parse_quiet = 0;
+
+static command_t *new_node(command_type_t type) {
+    command_t *cmd = arena_alloc(arena, sizeof(command_t));
+    cmd->type = type;
+    cmd->arena = arena;
+    return cmd;
+}
+
+typedef enum {
+    TOK_WORD,
+    TOK_SEMI,       // ;
+    TOK_DSEMI,      // ;;
+    TOK_AMP,        // &
+    TOK_AND,        // &&
+    TOK_PIPE,       // |
+    TOK_OR,         // ||
+    TOK_LESS,       // <
+    TOK_GREAT,      // >
+    TOK_DGREAT,     // >>
+    TOK_LPAREN,     // (
+    TOK_RPAREN,     // )
+    // Keywords are words too: they keep their text and can be arguments.
+    TOK_IF,
+    TOK_THEN,
+    TOK_ELSE,
+    TOK_FI,
+    TOK_WHILE,
+    TOK_DO,
+    TOK_DONE,
+    TOK_FOR,
+    TOK_IN,
+    TOK_CASE,
+    TOK_ESAC,
+    TOK_TIME
+} token_kind_t;
+
+static const char *const op_spelling[] = {
+    [TOK_SEMI] = ";", [TOK_DSEMI] = ";;", [TOK_AMP] = "&", [TOK_AND] = "&&",
+    [TOK_PIPE] = "|", [TOK_OR] = "||", [TOK_LESS] = "<", [TOK_GREAT] = ">",
+    [TOK_DGREAT] = ">>", [TOK_LPAREN] = "(", [TOK_RPAREN] = ")"
+};
+
+// Perfect hash over the keywords: first byte plus twice the last byte,
+// mod 32, is distinct for each of them (-Woverride-init flags a clash).
+#define KEYWORD_HASH(first, last) (((unsigned char)(first) + 2 * (unsigned char)(last)) & 31)
+#define KEYWORD(word, first, last, kind) \
+    [KEYWORD_HASH(first, last)] = { word, sizeof(word) - 1, kind }
+
+static const struct {
+    const char *word;
+    size_t len;
+    token_kind_t kind;
+} keywords[32] = {
+    KEYWORD("if", 'i', 'f', TOK_IF),
+    KEYWORD("then", 't', 'n', TOK_THEN),
+    KEYWORD("else", 'e', 'e', TOK_ELSE),
+    KEYWORD("fi", 'f', 'i', TOK_FI),
+    KEYWORD("while", 'w', 'e', TOK_WHILE),
+    KEYWORD("do", 'd', 'o', TOK_DO),
+    KEYWORD("done", 'd', 'e', TOK_DONE),
+    KEYWORD("for", 'f', 'r', TOK_FOR),
+    KEYWORD("in", 'i', 'n', TOK_IN),
+    KEYWORD("case", 'c', 'e', TOK_CASE),
+    KEYWORD("esac", 'e', 'c', TOK_ESAC),
+    KEYWORD("time", 't', 'e', TOK_TIME)
+};
+
+// Kind of a word slice: one table probe and at most one memcmp.
+static token_kind_t classify_word(const char *s, size_t len) {
+    if (len < 2 || len > 5) return TOK_WORD;
+    unsigned h = KEYWORD_HASH(s[0], s[len - 1]);
+    if (keywords[h].len == len && memcmp(keywords[h].word, s, len) == 0)
+        return keywords[h].kind;
+    return TOK_WORD;
+}
+
+static int is_wordlike(token_kind_t kind) {
+    return kind == TOK_WORD || kind >= TOK_IF;
+}
+
+// A slice of the line being parsed. Words get a NUL-terminated text in
+// place; operators only get one if the parser uses them as a word.
+typedef struct {
+    token_kind_t kind;
+    size_t offset;
+    size_t len;
+    char *text;
+    int quoted;     // the word was written in quotes
+} token_t;
+
+static int is_operator_char(char c) {
+    return c == ';' || c == '&' || c == '|' || c == '<' || c == '>' || c == '(' || c == ')';
+}
+
+// Returns the operator starting at p and sets *len, or TOK_WORD.
+static token_kind_t scan_operator(const char *p, size_t *len) {
+    *len = 2;
+    if (p[0] == ';' && p[1] == ';') return TOK_DSEMI;
+    if (p[0] == '&' && p[1] == '&') return TOK_AND;
+    if (p[0] == '|' && p[1] == '|') return TOK_OR;
+    if (p[0] == '>' && p[1] == '>') return TOK_DGREAT;
+    *len = 1;
+    switch (p[0]) {
+        case ';': return TOK_SEMI;
+        case '&': return TOK_AMP;
+        case '|': return TOK_PIPE;
+        case '<': return TOK_LESS;
+        case '>': return TOK_GREAT;
+        case '(': return TOK_LPAREN;
+        case ')': return TOK_RPAREN;
+    }
+    return TOK_WORD;
+}
+
+// A newline separates commands like ';' unless the line before it is
+// unfinished (it ends in |, &&, then, do, ...), the next line continues the
+// construct (then, do, fi, ;;, ...), or it sits between case patterns.
+static int newline_separates(token_kind_t prev, token_kind_t next) {
+    switch (prev) {
+        case TOK_SEMI: case TOK_DSEMI: case TOK_PIPE: case TOK_AND: case TOK_OR:
+        case TOK_LPAREN: case TOK_IF: case TOK_THEN: case TOK_ELSE: case TOK_WHILE:
+        case TOK_DO: case TOK_IN: case TOK_TIME:
+            return 0;
+        default:
+            break;
+    }
+    switch (next) {
+        case TOK_SEMI: case TOK_DSEMI: case TOK_PIPE: case TOK_AND: case TOK_OR:
+        case TOK_RPAREN: case TOK_THEN: case TOK_ELSE: case TOK_FI: case TOK_DO:
+        case TOK_DONE: case TOK_IN: case TOK_ESAC:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+// Splits line into slices. The token array grows as needed. Word text is
+// terminated in place when the byte after it is a separator, a closing
+// quote or an operator (whose kind is already recorded); only a word
+// directly followed by another word, as in "*)x", is copied out.
+// Newlines become ';' tokens where newline_separates() says so.
+static token_t *tokenize(char *line, int *count) {
+    int cap = 16;
+    token_t *tokens = arena_alloc(arena, sizeof(token_t) * cap);
     *count = 0;
-    const char *p = input;
+    int in_patterns = 0;    // after "case WORD in" or ";;", before the ')'
+    int closed_pattern = 0; // the last token ended a case pattern
+    const char *p = line;
     while (*p) {
-        while (isspace(*p)) p++;
+        int newline = 0;
+        while (isspace((unsigned char)*p)) newline |= *p++ == '\n';
         if (!*p) break;
-        if (*p == ';' || *p == '&' || *p == '|' || *p == '<' || *p == '>' || *p == '(' || *p == ')') {
-            if (*p == ';' && *(p+1) == ';') {
-                tokens[(*count)++] = strdup(";;");
-                p += 2;
-            }
-            else if ((*p == '&' && *(p+1) == '&') || (*p == '|' && *(p+1) == '|')) {
-                char token[3] = {*p, *p, '\0'};
-                tokens[(*count)++] = strdup(token);
-                p += 2;
-            }
-            else if (*p == '>' && *(p+1) == '>') {
-                tokens[(*count)++] = strdup(">>");
-                p += 2;
-            } else {
-                char token[2] = {*p, '\0'};
-                tokens[(*count)++] = strdup(token);
-                p++;
-            }
-            continue;
+        // Room for the token and a separator before it.
+        if (*count + 2 > cap) {
+            token_t *grown = arena_alloc(arena, sizeof(token_t) * cap * 2);
+            memcpy(grown, tokens, sizeof(token_t) * cap);
+            tokens = grown;
+            cap *= 2;
         }
-        char token[1024] = {0};
-        int t = 0;
-        if (*p == '"' || *p == '\'') {
-            char quote = *p++;
-            while (*p && *p != quote)
-                token[t++] = *p++;
-            if (*p == quote) p++;
+        token_t t;
+        size_t oplen;
+        t.kind = scan_operator(p, &oplen);
+        t.text = NULL;
+        t.quoted = 0;
+        if (t.kind != TOK_WORD) {
+            t.offset = p - line;
+            t.len = oplen;
+            p += oplen;
         } else {
-            while (*p && !isspace(*p) &&
-                   *p != ';' && *p != '&' && *p != '|' &&
-                   *p != '<' && *p != '>' && *p != '(' && *p != ')') {
-                if (*p == '*' && *(p+1) == ')') {
-                    token[t++] = *p++;
-                    token[t++] = *p++;
-                    break;
+            if (*p == '"' || *p == '\'') {
+                char quote = *p++;
+                const char *start = p;
+                while (*p && *p != quote) p++;
+                t.offset = start - line;
+                t.len = p - start;
+                if (*p == quote) p++;
+                t.quoted = 1;
+            } else {
+                const char *start = p;
+                while (*p && !isspace((unsigned char)*p) && !is_operator_char(*p)) {
+                    if (*p == '*' && *(p+1) == ')') {
+                        p += 2;
+                        break;
+                    }
+                    p++;
                 }
-                token[t++] = *p++;
+                t.offset = start - line;
+                t.len = p - start;
             }
+            // Quoted keywords stay keywords, as before classification.
+            t.kind = classify_word(line + t.offset, t.len);
+        }
+        if (newline && *count > 0 && !in_patterns && !closed_pattern &&
+            newline_separates(tokens[*count - 1].kind, t.kind))
+            tokens[(*count)++] = (token_t){ TOK_SEMI, t.offset, 0, NULL, 0 };
+        tokens[(*count)++] = t;
+        closed_pattern = in_patterns &&
+                         (t.kind == TOK_RPAREN || (t.len > 0 && line[t.offset + t.len - 1] == ')'));
+        if (closed_pattern || t.kind == TOK_ESAC) in_patterns = 0;
+        if (t.kind == TOK_DSEMI ||
+            (t.kind == TOK_IN && *count >= 3 && tokens[*count - 3].kind == TOK_CASE))
+            in_patterns = 1;
+    }
+    // Terminate words now that every operator has been classified.
+    for (int i = 0; i < *count; i++) {
+        token_t *t = &tokens[i];
+        if (!is_wordlike(t->kind)) continue;
+        char *end = line + t->offset + t->len;
+        int next_is_word = i + 1 < *count && is_wordlike(tokens[i + 1].kind) &&
+                           tokens[i + 1].offset == t->offset + t->len;
+        if (next_is_word) {
+            t->text = arena_strndup(arena, line + t->offset, t->len);
+        } else {
+            *end = '\0';
+            t->text = line + t->offset;
         }
-        token[t] = '\0';
-        tokens[(*count)++] = strdup(token);
     }
-    tokens[*count] = NULL;
     return tokens;
 }
 
+// Text of a token; operators are spelled out on first use as a word.
+static char *tok_text(token_t *t) {
+    if (!t->text) t->text = arena_strdup(arena, op_spelling[t->kind]);
+    return t->text;
+}
+
+static int is_kind(const token_t *t, token_kind_t kind) {
+    return t->kind == kind;
+}
+
 // Forward declarations
-static command_t *parse_command(char **tokens, int *pos, int count);
-static command_t *parse_if(char **tokens, int *pos, int count);
-static command_t *parse_while(char **tokens, int *pos, int count);
-static command_t *parse_for(char **tokens, int *pos, int count);
-static command_t *parse_case(char **tokens, int *pos, int count);
-static command_t *parse_simple(char **tokens, int *pos, int count);
-static command_t *parse_subshell(char **tokens, int *pos, int count);
-static command_t *parse_pipeline(char **tokens, int *pos, int count);
+static command_t *parse_command(token_t *tokens, int *pos, int count);
+static command_t *parse_if(token_t *tokens, int *pos, int count);
+static command_t *parse_while(token_t *tokens, int *pos, int count);
+static command_t *parse_for(token_t *tokens, int *pos, int count);
+static command_t *parse_case(token_t *tokens, int *pos, int count);
+static command_t *parse_simple(token_t *tokens, int *pos, int count);
+static command_t *parse_subshell(token_t *tokens, int *pos, int count);
+static command_t *parse_pipeline(token_t *tokens, int *pos, int count);
+static command_t *parse_time(token_t *tokens, int *pos, int count);
+static command_t *parse_unit(token_t *tokens, int *pos, int count);
 
 command_t *parse_input(char *input) {
+    arena = arena_create();
+    if (!arena) return NULL;
+    lines_parsed++;
+    // Tokens and AST strings live in this one copy of the line.
+    char *line = arena_strdup(arena, input);
     int count = 0;
-    char **tokens = tokenize(input, &count);
+    token_t *tokens = tokenize(line, &count);
     int pos = 0;
     command_t *cmd = parse_command(tokens, &pos, count);
-    for (int i = 0; i < count; i++) free(tokens[i]);
-    free(tokens);
+    if (cmd) cmd->arena_root = 1;
+    else arena_destroy(arena);
+    arena = NULL;
     return cmd;
 }
 
-static command_t *parse_command(char **tokens, int *pos, int count) {
+// How parse_scan_line() treats each byte outside quotes. Bytes without an
+// entry are word characters; the table replaces per-byte isspace() and
+// scan_operator() calls on the hot path.
+enum { SCAN_WORD, SCAN_BLANK, SCAN_OPERATOR, SCAN_QUOTE, SCAN_BACKSLASH };
+static const unsigned char scan_class[256] = {
+    [' '] = SCAN_BLANK, ['\t'] = SCAN_BLANK, ['\r'] = SCAN_BLANK,
+    ['\n'] = SCAN_BLANK, ['\v'] = SCAN_BLANK, ['\f'] = SCAN_BLANK,
+    [';'] = SCAN_OPERATOR, ['&'] = SCAN_OPERATOR, ['|'] = SCAN_OPERATOR,
+    ['<'] = SCAN_OPERATOR, ['>'] = SCAN_OPERATOR, ['('] = SCAN_OPERATOR,
+    [')'] = SCAN_OPERATOR,
+    ['"'] = SCAN_QUOTE, ['\''] = SCAN_QUOTE, ['\\'] = SCAN_BACKSLASH,
+};
+
+int parse_scan_line(parse_state_t *state, char *line, size_t len) {
+    size_t i = 0;
+    if (!state->quote) {
+        while (i < len && scan_class[(unsigned char)line[i]] == SCAN_BLANK) i++;
+        // Whole-line comments are blanked; continuations carry across them
+        // and across blank lines.
+        if (i == len || line[i] == '#') {
+            memset(line, ' ', len);
+            return !state->depth && !state->parens && !state->continued;
+        }
+    }
+    int command_position = 1;
+    state->continued = 0;
+    while (i < len) {
+        if (state->quote) {
+            const char *close = memchr(line + i, state->quote, len - i);
+            if (!close) break;
+            state->quote = 0;
+            i = close - line + 1;
+            continue;
+        }
+        char c = line[i];
+        switch (scan_class[(unsigned char)c]) {
+            case SCAN_BLANK:
+                i++;
+                continue;
+            case SCAN_QUOTE:
+                // Only a quote at the start of a word opens a quoted word,
+                // as in the tokenizer.
+                state->continued = 0;
+                state->quote = c;
+                command_position = 0;
+                i++;
+                continue;
+            case SCAN_OPERATOR: {
+                size_t oplen;
+                token_kind_t op = scan_operator(line + i, &oplen);
+                if (op == TOK_LPAREN) state->parens++;
+                else if (op == TOK_RPAREN && state->parens > 0) state->parens--;
+                state->continued = op == TOK_PIPE || op == TOK_AND || op == TOK_OR;
+                command_position = 1;
+                i += oplen;
+                continue;
+            }
+            case SCAN_BACKSLASH:
+                if (i + 1 == len) {
+                    // Backslash-newline joins the lines.
+                    line[i++] = ' ';
+                    if (line[len] == '\n') line[len] = ' ';
+                    state->continued = 1;
+                    continue;
+                }
+                break;
+        }
+        state->continued = 0;
+        // Words end where the tokenizer ends them, "*)" included.
+        size_t start = i;
+        while (i < len && scan_class[(unsigned char)line[i]] != SCAN_BLANK &&
+               scan_class[(unsigned char)line[i]] != SCAN_OPERATOR)
+            i++;
+        if (i < len && line[i] == ')' && line[i - 1] == '*') i++;
+        // Only keywords in command position open a construct, so
+        // "echo if" does not swallow the rest of the script.
+        switch (classify_word(line + start, i - start)) {
+            case TOK_IF: case TOK_WHILE:
+                if (command_position) state->depth++;
+                break;
+            case TOK_FOR: case TOK_CASE:
+                if (command_position) state->depth++;
+                command_position = 0;
+                break;
+            case TOK_FI: case TOK_DONE: case TOK_ESAC:
+                if (state->depth > 0) state->depth--;
+                command_position = 0;
+                break;
+            case TOK_THEN: case TOK_ELSE: case TOK_DO: case TOK_TIME:
+                command_position = 1;
+                break;
+            default:
+                command_position = 0;
+                break;
+        }
+    }
+    return !state->quote && !state->depth && !state->parens && !state->continued;
+}
+
+unsigned long parsed_line_count(void) {
+    return lines_parsed;
+}
+
+unsigned long parse_error_count(void) {
+    return parse_errors;
+}
+
+// One if/while/for/case/time construct or pipeline, without what follows.
+static command_t *parse_unit(token_t *tokens, int *pos, int count) {
+    switch (tokens[*pos].kind) {
+        case TOK_IF: return parse_if(tokens, pos, count);
+        case TOK_WHILE: return parse_while(tokens, pos, count);
+        case TOK_FOR: return parse_for(tokens, pos, count);
+        case TOK_CASE: return parse_case(tokens, pos, count);
+        case TOK_TIME: return parse_time(tokens, pos, count);
+        default: return parse_pipeline(tokens, pos, count);
+    }
+}
+
+static command_t *parse_command(token_t *tokens, int *pos, int count) {
     if (*pos >= count) return NULL;
-    if (strcmp(tokens[*pos], "if") == 0) return parse_if(tokens, pos, count);
-    if (strcmp(tokens[*pos], "while") == 0) return parse_while(tokens, pos, count);
-    if (strcmp(tokens[*pos], "for") == 0) return parse_for(tokens, pos, count);
-    if (strcmp(tokens[*pos], "case") == 0) return parse_case(tokens, pos, count);
-    command_t *cmd = parse_pipeline(tokens, pos, count);
-    if (*pos < count && strcmp(tokens[*pos], ";") == 0) {
+    command_t *cmd = parse_unit(tokens, pos, count);
+    if (*pos < count && is_kind(&tokens[*pos], TOK_SEMI)) {
         (*pos)++;
-        command_t *seq = malloc(sizeof(command_t));
-        memset(seq, 0, sizeof(command_t));
-        seq->type = CMD_SEQUENCE;
+        command_t *seq = new_node(CMD_SEQUENCE);
         seq->then_branch = cmd;
         seq->else_branch = parse_command(tokens, pos, count);
         return seq;
     }
-    else if (*pos < count && (strcmp(tokens[*pos], "&&") == 0 || strcmp(tokens[*pos], "||") == 0)) {
-        command_t *logical_cmd = malloc(sizeof(command_t));
-        memset(logical_cmd, 0, sizeof(command_t));
-        logical_cmd->type = (strcmp(tokens[*pos], "&&") == 0) ? CMD_AND : CMD_OR;
+    else if (*pos < count && (is_kind(&tokens[*pos], TOK_AND) || is_kind(&tokens[*pos], TOK_OR))) {
+        command_t *logical_cmd = new_node(is_kind(&tokens[*pos], TOK_AND) ? CMD_AND : CMD_OR);
         (*pos)++;
         logical_cmd->then_branch = cmd;
         logical_cmd->else_branch = parse_command(tokens, pos, count);
@@ -107,243 +410,299 @@ static command_t *parse_command(char **tokens, int *pos, int count) {
     return cmd;
 }
 
-static command_t *parse_if(char **tokens, int *pos, int count) {
-    command_t *cmd = malloc(sizeof(command_t));
-    memset(cmd, 0, sizeof(command_t));
-    cmd->type = CMD_IF;
+// Parses tokens[*pos..end) as a condition list, dropping a trailing ';'
+// before then/do. Leaves *pos at end.
+static command_t *parse_condition(token_t *tokens, int *pos, int end) {
+    int limit = end;
+    if (limit > *pos && is_kind(&tokens[limit - 1], TOK_SEMI)) limit--;
+    command_t *cond = NULL;
+    if (*pos < limit) cond = parse_command(tokens, pos, limit);
+    *pos = end;
+    return cond;
+}
+
+static command_t *parse_if(token_t *tokens, int *pos, int count) {
+    command_t *cmd = new_node(CMD_IF);
     (*pos)++; // Skip "if"
     int nested = 0;
-    char cond[1024] = {0};
-    while (*pos < count) {
-        if (strcmp(tokens[*pos], "if") == 0) nested++;
-        else if (strcmp(tokens[*pos], "fi") == 0 && nested > 0) nested--;
-        if (nested == 0 && strcmp(tokens[*pos], "then") == 0) break;
-        strcat(cond, tokens[*pos]);
-        strcat(cond, " ");
-        (*pos)++;
+    int end = *pos;
+    while (end < count) {
+        if (is_kind(&tokens[end], TOK_IF)) nested++;
+        else if (is_kind(&tokens[end], TOK_FI) && nested > 0) nested--;
+        if (nested == 0 && is_kind(&tokens[end], TOK_THEN)) break;
+        end++;
     }
-    cmd->if_condition = strdup(cond);
-    if (*pos < count && strcmp(tokens[*pos], "then") == 0) (*pos)++;
+    cmd->if_condition = parse_condition(tokens, pos, end);
+    if (*pos < count && is_kind(&tokens[*pos], TOK_THEN)) (*pos)++;
     cmd->then_branch = parse_command(tokens, pos, count);
-    if (*pos < count && strcmp(tokens[*pos], ";") == 0) (*pos)++;
-    if (*pos < count && strcmp(tokens[*pos], "else") == 0) {
+    if (*pos < count && is_kind(&tokens[*pos], TOK_SEMI)) (*pos)++;
+    if (*pos < count && is_kind(&tokens[*pos], TOK_ELSE)) {
         (*pos)++;
-        if (*pos < count && strcmp(tokens[*pos], "if") == 0) cmd->else_branch = parse_if(tokens, pos, count);
+        if (*pos < count && is_kind(&tokens[*pos], TOK_IF)) cmd->else_branch = parse_if(tokens, pos, count);
         else cmd->else_branch = parse_command(tokens, pos, count);
     }
-    if (*pos < count && strcmp(tokens[*pos], "fi") == 0) (*pos)++;
+    if (*pos < count && is_kind(&tokens[*pos], TOK_FI)) (*pos)++;
     return cmd;
 }
 
-static command_t *parse_while(char **tokens, int *pos, int count) {
-    command_t *cmd = malloc(sizeof(command_t));
-    memset(cmd, 0, sizeof(command_t));
-    cmd->type = CMD_WHILE;
+static command_t *parse_while(token_t *tokens, int *pos, int count) {
+    command_t *cmd = new_node(CMD_WHILE);
     (*pos)++;
-    char cond[1024] = {0};
-    while (*pos < count && strcmp(tokens[*pos], "do") != 0) {
-        strcat(cond, tokens[*pos]);
-        strcat(cond, " ");
-        (*pos)++;
-    }
-    cmd->while_condition = strdup(cond);
-    if (*pos < count && strcmp(tokens[*pos], "do") == 0) (*pos)++;
+    int end = *pos;
+    while (end < count && !is_kind(&tokens[end], TOK_DO)) end++;
+    cmd->while_condition = parse_condition(tokens, pos, end);
+    if (*pos < count && is_kind(&tokens[*pos], TOK_DO)) (*pos)++;
     cmd->while_body = parse_command(tokens, pos, count);
-    if (*pos < count && strcmp(tokens[*pos], "done") == 0) (*pos)++;
+    if (*pos < count && is_kind(&tokens[*pos], TOK_DONE)) (*pos)++;
     return cmd;
 }
 
-static command_t *parse_for(char **tokens, int *pos, int count) {
-    command_t *cmd = malloc(sizeof(command_t));
-    memset(cmd, 0, sizeof(command_t));
-    cmd->type = CMD_FOR;
+// Appends to a NULL-terminated vector of *cap slots, moving it to a
+// larger arena block when full.
+static char **push_word(char **v, int *count, int *cap, char *word) {
+    if (*count + 1 >= *cap) {
+        char **grown = arena_alloc(arena, sizeof(char*) * *cap * 2);
+        memcpy(grown, v, sizeof(char*) * *count);
+        v = grown;
+        *cap *= 2;
+    }
+    v[(*count)++] = word;
+    return v;
+}
+
+// push_word() with a parallel flag vector that is only allocated once a
+// word is flagged.
+static void push_flagged(char ***words, unsigned char **flags, int *count, int *cap,
+                         char *word, int flag) {
+    int old_cap = *cap;
+    *words = push_word(*words, count, cap, word);
+    if (*flags && *cap != old_cap) {
+        unsigned char *grown = arena_alloc(arena, *cap);
+        memcpy(grown, *flags, *count - 1);
+        *flags = grown;
+    }
+    if (flag) {
+        if (!*flags) *flags = arena_alloc(arena, *cap);
+        (*flags)[*count - 1] = 1;
+    }
+}
+
+// Adds an argument; brace expansion can yield more than there were tokens.
+// Quoted words are not expanded as file patterns, so those with pattern
+// characters are flagged.
+static void add_arg(command_t *cmd, int *cap, char *word, int quoted) {
+    push_flagged(&cmd->args, &cmd->quoted_args, &cmd->arg_count, cap, word,
+                 quoted && strpbrk(word, "*?["));
+}
+
+static command_t *parse_for(token_t *tokens, int *pos, int count) {
+    command_t *cmd = new_node(CMD_FOR);
     (*pos)++;
     if (*pos < count) {
-        cmd->for_variable = strdup(tokens[*pos]);
+        cmd->for_variable = tok_text(&tokens[*pos]);
         (*pos)++;
     }
-    if (*pos < count && strcmp(tokens[*pos], "in") == 0) (*pos)++;
-    char **list = malloc(sizeof(char*) * 64);
+    if (*pos < count && is_kind(&tokens[*pos], TOK_IN)) (*pos)++;
+    int end = *pos;
+    while (end < count && !is_kind(&tokens[end], TOK_DO)) end++;
+    // "for x in a b; do": the ';' before do is not an item.
+    int list_end = end;
+    if (list_end > *pos && is_kind(&tokens[list_end - 1], TOK_SEMI)) list_end--;
+    int cap = list_end - *pos + 1;
+    char **list = arena_alloc(arena, sizeof(char*) * cap);
     int list_count = 0;
-    while (*pos < count && strcmp(tokens[*pos], "do") != 0) {
-        list[list_count++] = strdup(tokens[*pos]);
-        (*pos)++;
+    while (*pos < list_end) {
+        token_t *t = &tokens[(*pos)++];
+        char *word = tok_text(t);
+        // A word that is one range stays as it is; the loop steps through
+        // it lazily (vm.c). Quoted ranges are flagged so they stay literal.
+        brace_range_t range;
+        int is_range = brace_parse_range(word, &range);
+        if (t->quoted || is_range || !brace_has_expansion(word)) {
+            push_flagged(&list, &cmd->for_quoted, &list_count, &cap, word,
+                         t->quoted && is_range);
+            continue;
+        }
+        brace_words_t words = { 0 };
+        brace_expand(arena, word, &words);
+        for (size_t i = 0; i < words.count; i++)
+            push_flagged(&list, &cmd->for_quoted, &list_count, &cap, words.words[i], 0);
+        brace_words_free(&words);
     }
     list[list_count] = NULL;
     cmd->for_list = list;
-    if (*pos < count && strcmp(tokens[*pos], "do") == 0) (*pos)++;
+    *pos = end;
+    if (*pos < count && is_kind(&tokens[*pos], TOK_DO)) (*pos)++;
     cmd->for_body = parse_command(tokens, pos, count);
-    if (*pos < count && strcmp(tokens[*pos], "done") == 0) (*pos)++;
+    if (*pos < count && is_kind(&tokens[*pos], TOK_DONE)) (*pos)++;
     return cmd;
 }
 
-static command_t *parse_case_body_simple(char **tokens, int *pos, int count) {
-    int start = *pos;
-    while (*pos < count) {
-        if (strcmp(tokens[*pos], "esac") == 0)
-            break;
-        if (strcmp(tokens[*pos], ";;") == 0)
-            break;
-        if (strcmp(tokens[*pos], ";") == 0) {
-            if (*pos + 1 < count && strcmp(tokens[*pos + 1], ";;") == 0)
-                break;
-        }
-        (*pos)++;
-    }
-    char body_str[4096] = "";
-    for (int i = start; i < *pos; i++) {
-        strcat(body_str, tokens[i]);
-        if (i < *pos - 1) {
-            strcat(body_str, " ");
-        }
-    }
-    command_t *cmd = malloc(sizeof(command_t));
-    memset(cmd, 0, sizeof(command_t));
-    cmd->type = CMD_SIMPLE;
-    cmd->command = strdup(body_str);
-    cmd->args = malloc(sizeof(char*) * 64);
-    cmd->arg_count = 0;
-    char *temp = strdup(body_str);
-    char *tok = strtok(temp, " ");
-    while (tok) {
-        cmd->args[cmd->arg_count++] = strdup(tok);
-        tok = strtok(NULL, " ");
+// An arm's body runs to the next ";;" or "esac" outside a nested case.
+static int case_arm_end(token_t *tokens, int pos, int count) {
+    int nested = 0;
+    for (; pos < count; pos++) {
+        if (is_kind(&tokens[pos], TOK_CASE)) nested++;
+        else if (is_kind(&tokens[pos], TOK_ESAC) && nested-- == 0) break;
+        else if (is_kind(&tokens[pos], TOK_DSEMI) && nested == 0) break;
     }
-    cmd->args[cmd->arg_count] = NULL;
-    free(temp);
-    return cmd;
+    return pos;
 }
 
-static command_t *parse_case(char **tokens, int *pos, int count) {
-    command_t *cmd = malloc(sizeof(command_t));
-    memset(cmd, 0, sizeof(command_t));
-    cmd->type = CMD_CASE;
+static command_t *parse_case(token_t *tokens, int *pos, int count) {
+    command_t *cmd = new_node(CMD_CASE);
     (*pos)++;
     if (*pos < count) {
-        cmd->case_expression = strdup(tokens[*pos]);
+        cmd->case_expression = tok_text(&tokens[*pos]);
         (*pos)++;
     }
-    if (*pos < count && strcmp(tokens[*pos], "in") == 0) (*pos)++;
-    cmd->case_entries = NULL;
-    cmd->case_entry_count = 0;
-    while (*pos < count && strcmp(tokens[*pos], "esac") != 0) {
-        while (*pos < count && strcmp(tokens[*pos], ";;") == 0) (*pos)++;
-        if (*pos >= count || strcmp(tokens[*pos], "esac") == 0) break;
-        char *pattern = strdup(tokens[*pos]);
+    if (*pos < count && is_kind(&tokens[*pos], TOK_IN)) (*pos)++;
+    int entry_cap = 0;
+    while (*pos < count && !is_kind(&tokens[*pos], TOK_ESAC)) {
+        while (*pos < count && is_kind(&tokens[*pos], TOK_DSEMI)) (*pos)++;
+        if (*pos >= count || is_kind(&tokens[*pos], TOK_ESAC)) break;
+        char *pattern = tok_text(&tokens[*pos]);
         size_t len = strlen(pattern);
         if (len > 0 && pattern[len - 1] == ')')
             pattern[len - 1] = '\0';
         (*pos)++;
-        if (*pos < count && strcmp(tokens[*pos], ")") == 0) (*pos)++;
-        command_t *body = parse_case_body_simple(tokens, pos, count);
-        cmd->case_entries = realloc(cmd->case_entries, sizeof(case_entry_t*) * (cmd->case_entry_count + 1));
-        case_entry_t *entry = malloc(sizeof(case_entry_t));
+        if (*pos < count && is_kind(&tokens[*pos], TOK_RPAREN)) (*pos)++;
+        int end = case_arm_end(tokens, *pos, count);
+        command_t *body = *pos < end ? parse_command(tokens, pos, end) : NULL;
+        *pos = end;
+        if (cmd->case_entry_count == entry_cap) {
+            entry_cap = entry_cap ? entry_cap * 2 : 4;
+            case_entry_t **grown = arena_alloc(arena, sizeof(case_entry_t*) * entry_cap);
+            if (cmd->case_entry_count)
+                memcpy(grown, cmd->case_entries, sizeof(case_entry_t*) * cmd->case_entry_count);
+            cmd->case_entries = grown;
+        }
+        case_entry_t *entry = arena_alloc(arena, sizeof(case_entry_t));
         entry->pattern = pattern;
         entry->body = body;
         cmd->case_entries[cmd->case_entry_count++] = entry;
         while (*pos < count &&
-              (strcmp(tokens[*pos], ";") == 0 ||
-               strcmp(tokens[*pos], ";;") == 0 ||
-               strcmp(tokens[*pos], ")") == 0))
+              (is_kind(&tokens[*pos], TOK_SEMI) ||
+               is_kind(&tokens[*pos], TOK_DSEMI) ||
+               is_kind(&tokens[*pos], TOK_RPAREN)))
               (*pos)++;
     }
-    if (*pos < count && strcmp(tokens[*pos], "esac") == 0) (*pos)++;
+    if (*pos < count && is_kind(&tokens[*pos], TOK_ESAC)) (*pos)++;
     return cmd;
 }
 
-static command_t *parse_simple(char **tokens, int *pos, int count) {
-    if (strcmp(tokens[*pos], "(") == 0) return parse_subshell(tokens, pos, count);
-    command_t *cmd = malloc(sizeof(command_t));
-    memset(cmd, 0, sizeof(command_t));
-    cmd->type = CMD_SIMPLE;
-    cmd->args = malloc(sizeof(char*) * 64);
+// Tokens that end a simple command.
+static int ends_simple(const token_t *tok) {
+    switch (tok->kind) {
+        case TOK_IF: case TOK_WHILE: case TOK_FOR: case TOK_THEN:
+        case TOK_ELSE: case TOK_FI: case TOK_DO: case TOK_DONE:
+        case TOK_SEMI: case TOK_PIPE: case TOK_AND: case TOK_OR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static command_t *parse_simple(token_t *tokens, int *pos, int count) {
+    if (is_kind(&tokens[*pos], TOK_LPAREN)) return parse_subshell(tokens, pos, count);
+    command_t *cmd = new_node(CMD_SIMPLE);
+    int end = *pos;
+    while (end < count && !ends_simple(&tokens[end])) end++;
+    int cap = end - *pos + 1;
+    cmd->args = arena_alloc(arena, sizeof(char*) * cap);
     cmd->arg_count = 0;
     while (*pos < count) {
-        if (strcmp(tokens[*pos], "if") == 0 ||
-            strcmp(tokens[*pos], "while") == 0 ||
-            strcmp(tokens[*pos], "for") == 0 ||
-            strcmp(tokens[*pos], "then") == 0 ||
-            strcmp(tokens[*pos], "else") == 0 ||
-            strcmp(tokens[*pos], "fi") == 0 ||
-            strcmp(tokens[*pos], "do") == 0 ||
-            strcmp(tokens[*pos], "done") == 0 ||
-            strcmp(tokens[*pos], ";") == 0 ||
-            strcmp(tokens[*pos], "|") == 0 ||
-            strcmp(tokens[*pos], "&&") == 0 ||
-            strcmp(tokens[*pos], "||") == 0)
+        if (ends_simple(&tokens[*pos]))
             break;
-        if (strcmp(tokens[*pos], "&") == 0) {
+        if (is_kind(&tokens[*pos], TOK_AMP)) {
             cmd->background = 1;
             (*pos)++;
             continue;
         }
-        if (strcmp(tokens[*pos], "<") == 0) {
+        if (is_kind(&tokens[*pos], TOK_LESS)) {
             (*pos)++;
-            if (*pos < count) { cmd->input_file = strdup(tokens[*pos]); (*pos)++; }
+            if (*pos < count) { cmd->input_file = tok_text(&tokens[*pos]); (*pos)++; }
             continue;
         }
-        if (strcmp(tokens[*pos], ">") == 0 || strcmp(tokens[*pos], ">>") == 0) {
-            int is_append = (strcmp(tokens[*pos], ">>") == 0);
+        if (is_kind(&tokens[*pos], TOK_GREAT) || is_kind(&tokens[*pos], TOK_DGREAT)) {
+            int is_append = (is_kind(&tokens[*pos], TOK_DGREAT));
             (*pos)++;
-            if (*pos < count) { cmd->output_file = strdup(tokens[*pos]); cmd->append_output = is_append; (*pos)++; }
+            if (*pos < count) { cmd->output_file = tok_text(&tokens[*pos]); cmd->append_output = is_append; (*pos)++; }
             continue;
         }
-        cmd->args[cmd->arg_count++] = strdup(tokens[*pos]);
-        (*pos)++;
+        token_t *t = &tokens[(*pos)++];
+        char *word = tok_text(t);
+        if (t->quoted || !strchr(word, '{') || !brace_has_expansion(word)) {
+            add_arg(cmd, &cap, word, t->quoted);
+            continue;
+        }
+        brace_words_t words = { 0 };
+        brace_expand(arena, word, &words);
+        for (size_t i = 0; i < words.count; i++)
+            add_arg(cmd, &cap, words.words[i], 0);
+        brace_words_free(&words);
     }
     cmd->args[cmd->arg_count] = NULL;
-    if (cmd->arg_count > 0) cmd->command = strdup(cmd->args[0]);
+    if (cmd->arg_count > 0) cmd->command = cmd->args[0];
     return cmd;
 }
 
-static command_t *parse_subshell(char **tokens, int *pos, int count) {
+static command_t *parse_subshell(token_t *tokens, int *pos, int count) {
     (*pos)++;
-    char buffer[4096] = "";
+    int end = *pos;
     int nested = 1;
-    while (*pos < count && nested > 0) {
-        if (strcmp(tokens[*pos], "(") == 0) nested++;
-        else if (strcmp(tokens[*pos], ")") == 0) {
-            nested--;
-            if(nested == 0) { (*pos)++; break; }
-        }
-        if (nested > 0) { strcat(buffer, tokens[*pos]); strcat(buffer, " "); }
-        (*pos)++;
+    while (end < count) {
+        if (is_kind(&tokens[end], TOK_LPAREN)) nested++;
+        else if (is_kind(&tokens[end], TOK_RPAREN) && --nested == 0) break;
+        end++;
     }
-    if (nested != 0) { fprintf(stderr, "Error: missing closing parenthesis\n"); return NULL; }
-    command_t *cmd = malloc(sizeof(command_t));
-    memset(cmd, 0, sizeof(command_t));
-    cmd->type = CMD_SIMPLE;
-    cmd->args = malloc(sizeof(char*) * 4);
-    cmd->args[0] = strdup("sh");
-    cmd->args[1] = strdup("-c");
-    cmd->args[2] = strdup(buffer);
-    cmd->args[3] = NULL;
-    cmd->arg_count = 3;
-    cmd->command = strdup(buffer);
+    if (nested != 0) {
+        if (!parse_quiet) fprintf(stderr, "Error: missing closing parenthesis\n");
+        parse_errors++;
+        return NULL;
+    }
+    command_t *cmd = new_node(CMD_SUBSHELL);
+    cmd->subshell_cmd = (*pos < end) ? parse_command(tokens, pos, end) : NULL;
+    *pos = end + 1;
     while (*pos < count &&
-          (strcmp(tokens[*pos], "<") == 0 ||
-           strcmp(tokens[*pos], ">") == 0 ||
-           strcmp(tokens[*pos], ">>") == 0)) {
-        if (strcmp(tokens[*pos], "<") == 0) {
+          (is_kind(&tokens[*pos], TOK_LESS) ||
+           is_kind(&tokens[*pos], TOK_GREAT) ||
+           is_kind(&tokens[*pos], TOK_DGREAT) ||
+           is_kind(&tokens[*pos], TOK_AMP))) {
+        if (is_kind(&tokens[*pos], TOK_AMP)) {
+            cmd->background = 1;
+            (*pos)++;
+        } else if (is_kind(&tokens[*pos], TOK_LESS)) {
             (*pos)++;
-            if (*pos < count) { cmd->input_file = strdup(tokens[*pos]); (*pos)++; }
+            if (*pos < count) { cmd->input_file = tok_text(&tokens[*pos]); (*pos)++; }
         } else {
-            int append = (strcmp(tokens[*pos], ">>") == 0);
+            int append = (is_kind(&tokens[*pos], TOK_DGREAT));
             (*pos)++;
-            if (*pos < count) { cmd->output_file = strdup(tokens[*pos]); cmd->append_output = append; (*pos)++; }
+            if (*pos < count) { cmd->output_file = tok_text(&tokens[*pos]); cmd->append_output = append; (*pos)++; }
         }
     }
     return cmd;
 }
 
+// time keyword: times the following pipeline, or a whole if/while/for/case.
+static command_t *parse_time(token_t *tokens, int *pos, int count) {
+    command_t *cmd = new_node(CMD_TIME);
+    (*pos)++; // Skip "time"
+    if (*pos < count) cmd->timed_cmd = parse_unit(tokens, pos, count);
+    return cmd;
+}
+
 // [Restored] Function: parse_pipeline
-static command_t *parse_pipeline(char **tokens, int *pos, int count) {
+static command_t *parse_pipeline(token_t *tokens, int *pos, int count) {
     command_t *head = parse_simple(tokens, pos, count);
     command_t *current = head;
-    while (*pos < count && strcmp(tokens[*pos], "|") == 0) {
+    while (*pos < count && is_kind(&tokens[*pos], TOK_PIPE)) {
         (*pos)++;  // Skip the pipe token
         current->next = parse_simple(tokens, pos, count);
         current = current->next;
+        if (!current) break;
+        // A trailing & backgrounds the whole pipeline, which is keyed on its head.
+        if (current->background && head) head->background = 1;
     }
     return head;
 }
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "path_cache.h"
+#include "constants.h"
+
+#define PATH_CACHE_BUCKETS 256
+
+typedef struct path_dir_t {
+    char *dir;
+    struct timespec mtime;
+} path_dir_t;
+
+typedef struct path_entry_t {
+    char *name;
+    char *path;          // NULL for a cached miss
+    int dir_index;       // PATH element that produced path, -1 for a miss
+    int hits;
+    struct path_entry_t *next;
+} path_entry_t;
+
+static path_entry_t *buckets[PATH_CACHE_BUCKETS];
+static path_dir_t *dirs = NULL;
+static int dir_count = 0;
+static char *cached_path_var = NULL;
+
+static unsigned int hash_name(const char *name) {
+    unsigned int h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h % PATH_CACHE_BUCKETS;
+}
+
+static void dir_mtime(const char *dir, struct timespec *ts) {
+    struct stat st;
+    if (stat(*dir ? dir : ".", &st) == 0) {
+        *ts = st.st_mtim;
+    } else {
+        ts->tv_sec = -1;
+        ts->tv_nsec = 0;
+    }
+}
+
+static int dir_changed(int i) {
+    struct timespec now;
+    dir_mtime(dirs[i].dir, &now);
+    return now.tv_sec != dirs[i].mtime.tv_sec || now.tv_nsec != dirs[i].mtime.tv_nsec;
+}
+
+static void free_entries(void) {
+    for (int b = 0; b < PATH_CACHE_BUCKETS; b++) {
+        path_entry_t *e = buckets[b];
+        while (e) {
+            path_entry_t *next = e->next;
+            free(e->name);
+            free(e->path);
+            free(e);
+            e = next;
+        }
+        buckets[b] = NULL;
+    }
+}
+
+void path_cache_clear(void) {
+    free_entries();
+    for (int i = 0; i < dir_count; i++) free(dirs[i].dir);
+    free(dirs);
+    dirs = NULL;
+    dir_count = 0;
+    free(cached_path_var);
+    cached_path_var = NULL;
+}
+
+// Rebuilds the directory snapshot if PATH differs from the cached copy.
+static void sync_path_var(void) {
+    const char *path_var = getenv("PATH");
+    if (!path_var) path_var = "";
+    if (cached_path_var && strcmp(cached_path_var, path_var) == 0)
+        return;
+    path_cache_clear();
+    cached_path_var = strdup(path_var);
+    int n = 1;
+    for (const char *p = path_var; *p; p++)
+        if (*p == ':') n++;
+    dirs = malloc(sizeof(path_dir_t) * n);
+    const char *start = path_var;
+    for (int i = 0; i < n; i++) {
+        const char *end = strchr(start, ':');
+        size_t len = end ? (size_t)(end - start) : strlen(start);
+        dirs[i].dir = strndup(start, len);
+        dir_mtime(dirs[i].dir, &dirs[i].mtime);
+        start = end ? end + 1 : start + len;
+    }
+    dir_count = n;
+}
+
+// Walks PATH; returns malloc'd path and sets *index, or NULL.
+static char *resolve(const char *name, int *index) {
+    char candidate[MAX_PATH_LEN];
+    for (int i = 0; i < dir_count; i++) {
+        const char *dir = *dirs[i].dir ? dirs[i].dir : ".";
+        if (snprintf(candidate, sizeof(candidate), "%s/%s", dir, name) >= (int)sizeof(candidate))
+            continue;
+        struct stat st;
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+            *index = i;
+            return strdup(candidate);
+        }
+    }
+    *index = -1;
+    return NULL;
+}
+
+// An entry stays valid while no directory that could change its answer
+// has been modified: the ones searched before the hit plus the hit's own
+// directory, or every directory for a miss.
+static int entry_valid(const path_entry_t *e) {
+    int last = (e->dir_index >= 0) ? e->dir_index : dir_count - 1;
+    for (int i = 0; i <= last; i++) {
+        if (dir_changed(i)) return 0;
+    }
+    return 1;
+}
+
+static path_entry_t *find_entry(const char *name) {
+    sync_path_var();
+    unsigned int b = hash_name(name);
+    for (path_entry_t *e = buckets[b]; e; e = e->next) {
+        if (strcmp(e->name, name) != 0) continue;
+        if (entry_valid(e)) return e;
+        // A PATH directory changed, so any cached answer may be stale.
+        free_entries();
+        for (int i = 0; i < dir_count; i++)
+            dir_mtime(dirs[i].dir, &dirs[i].mtime);
+        break;
+    }
+    path_entry_t *e = malloc(sizeof(path_entry_t));
+    e->name = strdup(name);
+    e->path = resolve(name, &e->dir_index);
+    e->hits = 0;
+    e->next = buckets[b];
+    buckets[b] = e;
+    return e;
+}
+
+const char *path_cache_lookup(const char *name) {
+    if (strchr(name, '/')) return name;
+    if (!*name) return NULL;
+    path_entry_t *e = find_entry(name);
+    if (e->path) e->hits++;
+    return e->path;
+}
+
+int path_cache_seed(const char *name) {
+    if (strchr(name, '/') || !*name) return -1;
+    return find_entry(name)->path ? 0 : -1;
+}
+
+void path_cache_list(void) {
+    int any = 0;
+    for (int b = 0; b < PATH_CACHE_BUCKETS; b++) {
+        for (path_entry_t *e = buckets[b]; e; e = e->next) {
+            if (!any) { printf("hits\tcommand\n"); any = 1; }
+            if (e->path)
+                printf("%4d\t%s\n", e->hits, e->path);
+            else
+                printf("%4s\t%s (not found)\n", "-", e->name);
+        }
+    }
+    if (!any) printf("hash: hash table empty\n");
+}
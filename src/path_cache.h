@@ -0,0 +1,39 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+/**
+ * Resolves a command name to an executable path through $PATH.
+ * Results (including misses) are cached per session. A cached entry is
+ * revalidated against the mtimes of the PATH directories that could
+ * shadow or remove it, and the whole table is dropped when PATH changes.
+ * @param name Command name (argv[0])
+ * @return Resolved path, name itself if it contains '/', or NULL if not found.
+ *         Valid until the next path_cache_* call.
+ * @pre name is a non-NULL string
+ */
+const char *path_cache_lookup(const char *name);
+
+/**
+ * Resolves and records a command without running it.
+ * @param name Command name to seed
+ * @return 0 if found, -1 otherwise
+ * @pre name is a non-NULL string
+ * @post Table holds a positive or negative entry for name
+ */
+int path_cache_seed(const char *name);
+
+/**
+ * Forgets all cached resolutions.
+ * @pre None
+ * @post Table is empty; PATH directory snapshot is discarded
+ */
+void path_cache_clear(void);
+
+/**
+ * Prints cached resolutions with their hit counts.
+ * @pre None
+ * @post Entries are printed to stdout
+ */
+void path_cache_list(void);
+
+#endif
@@ -21,10 +21,8 @@ char *get_rc_path(void) {
 static void handle_export(const char *line) {
     char *eq = strchr(line, '=');
     if (eq) {
-        char var[256];
-        int len = eq - line - 7;  // "export " has length 7
-        strncpy(var, line + 7, len);
-        var[len] = '\0';
+        char *var = strndup(line + 7, eq - line - 7);  // "export " has length 7
+        if (!var) return;
         char *value = eq + 1;
         if (*value == '\'' || *value == '"') {
             value++;
@@ -32,16 +30,16 @@ static void handle_export(const char *line) {
             if (end) *end = '\0';
         }
         setenv(var, value, 1);
+        free(var);
     }
 }
 
 static void handle_alias(const char *line) {
     char *eq = strchr(line, '=');
     if (eq) {
-        char name[256];
         int len = eq - line - 6;  // "alias " length 6
-        strncpy(name, line + 6, len);
-        name[len] = '\0';
+        char *name = strndup(line + 6, len);
+        if (!name) return;
         while (len > 0 && isspace(name[len - 1])) {
             name[--len] = '\0';
         }
@@ -55,6 +53,7 @@ static void handle_alias(const char *line) {
             }
         }
         alias_add(name, value);
+        free(name);
     }
 }
 
@@ -66,9 +65,11 @@ int source_rc_file(const char *path) {
     if (!rc) {
         return -1;
     }
-    char line[SHELL_MAX_INPUT];
-    while (fgets(line, sizeof(line), rc)) {
-        size_t len = strlen(line);
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t read;
+    while ((read = getline(&line, &cap, rc)) != -1) {
+        size_t len = read;
         while (len > 0 && (line[len - 1] == '\n' || isspace(line[len - 1]))) {
             line[--len] = '\0';
         }
@@ -77,6 +78,7 @@ int source_rc_file(const char *path) {
         if (strncmp(line, "export ", 7) == 0) { handle_export(line); continue; }
         if (strncmp(line, "alias ", 6) == 0) { handle_alias(line); continue; }
     }
+    free(line);
     fclose(rc);
     return 0;
 }
@@ -0,0 +1,623 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shell.h"
+#include "arena.h"
+#include "script_cache.h"
+#include "script_reader.h"
+
+#define CACHE_MAGIC "JSHC"
+// Bump when the parser's output or this encoding changes.
+#define CACHE_FORMAT 5
+// Checksum of the parser's sources, set by the Makefile, so a rebuilt
+// parser never reuses trees from an older one.
+#ifndef JSHELL_PARSER_ID
+#define JSHELL_PARSER_ID "unknown"
+#endif
+#define NO_VALUE 0xffffffffu
+// Records are written out in batches of this size while a script runs.
+#define FLUSH_SIZE (256 * 1024)
+// Mapped pages behind the current record are released in steps of this size.
+#define RELEASE_STEP (1024 * 1024)
+
+int script_cache_enabled = 1;
+
+static unsigned long stat_hits = 0;
+static unsigned long stat_misses = 0;
+static unsigned long stat_stale = 0;
+static unsigned long stat_writes = 0;
+static unsigned long stat_write_errors = 0;
+
+// Image layout: header, NUL-terminated script path, then one record per
+// command: varint first line number, u8 parsed, and the tree if parsed.
+// A tree node is its type and a varint mask of the fields present, then
+// those fields in mask-bit order. Counts and lengths are LEB128 varints;
+// strings are length, bytes and a NUL, so loaded trees point straight into
+// the image. The header is native-endian; caches are never shared between
+// hosts.
+typedef struct {
+    char magic[4];
+    uint32_t format;
+    char version[16];
+    char parser_id[16];
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t size;
+    uint64_t checksum;      // of everything after the header
+    uint32_t path_len;
+    uint32_t line_count;
+} cache_header_t;
+
+// Node field mask
+enum {
+    F_APPEND = 1 << 0,
+    F_BACKGROUND = 1 << 1,
+    F_COMMAND_ARG0 = 1 << 2,    // command is args[0]
+    F_COMMAND = 1 << 3,         // command is its own string (case bodies)
+    F_ARGS = 1 << 4,
+    F_INPUT = 1 << 5,
+    F_OUTPUT = 1 << 6,
+    F_FOR_VAR = 1 << 7,
+    F_FOR_LIST = 1 << 8,
+    F_CASE_EXPR = 1 << 9,
+    F_CASE_ENTRIES = 1 << 10,
+    F_CHILD = 1 << 11,          // 9 child bits follow, in child_slot order
+    F_QUOTED = 1 << 20,         // arg_count quoted_args bytes follow the args
+    F_FOR_QUOTED = 1 << 21      // one for_quoted byte per item follows the list
+};
+#define CHILD_COUNT 9
+
+static command_t **child_slot(command_t *cmd, int i) {
+    switch (i) {
+        case 0: return &cmd->next;
+        case 1: return &cmd->if_condition;
+        case 2: return &cmd->then_branch;
+        case 3: return &cmd->else_branch;
+        case 4: return &cmd->while_condition;
+        case 5: return &cmd->while_body;
+        case 6: return &cmd->for_body;
+        case 7: return &cmd->subshell_cmd;
+        default: return &cmd->timed_cmd;
+    }
+}
+
+// --- Writing ---
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} buf_t;
+
+static void put(buf_t *b, const void *p, size_t n) {
+    if (b->failed) return;
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + n) cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown) { b->failed = 1; return; }
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void put_varint(buf_t *b, uint32_t v) {
+    unsigned char bytes[5];
+    int n = 0;
+    while (v >= 0x80) {
+        bytes[n++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    bytes[n++] = v;
+    put(b, bytes, n);
+}
+
+static void put_str(buf_t *b, const char *s) {
+    size_t len = strlen(s);
+    put_varint(b, len);
+    put(b, s, len + 1);
+}
+
+static void put_node(buf_t *b, command_t *cmd) {
+    uint32_t mask = 0;
+    if (cmd->append_output) mask |= F_APPEND;
+    if (cmd->background) mask |= F_BACKGROUND;
+    if (cmd->command && cmd->args && cmd->command == cmd->args[0]) mask |= F_COMMAND_ARG0;
+    else if (cmd->command) mask |= F_COMMAND;
+    if (cmd->args) mask |= F_ARGS;
+    if (cmd->args && cmd->quoted_args) mask |= F_QUOTED;
+    if (cmd->input_file) mask |= F_INPUT;
+    if (cmd->output_file) mask |= F_OUTPUT;
+    if (cmd->for_variable) mask |= F_FOR_VAR;
+    if (cmd->for_list) mask |= F_FOR_LIST;
+    if (cmd->for_list && cmd->for_quoted) mask |= F_FOR_QUOTED;
+    if (cmd->case_expression) mask |= F_CASE_EXPR;
+    if (cmd->case_entries) mask |= F_CASE_ENTRIES;
+    for (int i = 0; i < CHILD_COUNT; i++)
+        if (*child_slot(cmd, i)) mask |= F_CHILD << i;
+    unsigned char type = cmd->type;
+    put(b, &type, 1);
+    put_varint(b, mask);
+    if (mask & F_COMMAND) put_str(b, cmd->command);
+    if (mask & F_ARGS) {
+        put_varint(b, cmd->arg_count);
+        for (int i = 0; i < cmd->arg_count; i++) put_str(b, cmd->args[i]);
+        if (mask & F_QUOTED) put(b, cmd->quoted_args, cmd->arg_count);
+    }
+    if (mask & F_INPUT) put_str(b, cmd->input_file);
+    if (mask & F_OUTPUT) put_str(b, cmd->output_file);
+    if (mask & F_FOR_VAR) put_str(b, cmd->for_variable);
+    if (mask & F_FOR_LIST) {
+        uint32_t n = 0;
+        while (cmd->for_list[n]) n++;
+        put_varint(b, n);
+        for (uint32_t i = 0; i < n; i++) put_str(b, cmd->for_list[i]);
+        if (mask & F_FOR_QUOTED) put(b, cmd->for_quoted, n);
+    }
+    if (mask & F_CASE_EXPR) put_str(b, cmd->case_expression);
+    if (mask & F_CASE_ENTRIES) {
+        put_varint(b, cmd->case_entry_count);
+        for (int i = 0; i < cmd->case_entry_count; i++) {
+            case_entry_t *entry = cmd->case_entries[i];
+            unsigned char has_body = entry->body != NULL;
+            put_str(b, entry->pattern ? entry->pattern : "");
+            put(b, &has_body, 1);
+            if (has_body) put_node(b, entry->body);
+        }
+    }
+    for (int i = 0; i < CHILD_COUNT; i++)
+        if (mask & (F_CHILD << i)) put_node(b, *child_slot(cmd, i));
+}
+
+// --- Reading ---
+
+// Every read is bounds-checked; a bad image yields NULL trees, not crashes.
+typedef struct {
+    char *data;
+    size_t len;
+    size_t pos;
+    int bad;
+    arena_t *arena;
+} reader_t;
+
+static uint32_t get_varint(reader_t *r) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (r->pos >= r->len) break;
+        unsigned char c = r->data[r->pos++];
+        v |= (uint32_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return v;
+    }
+    r->bad = 1;
+    return 0;
+}
+
+static char *get_str(reader_t *r) {
+    uint32_t len = get_varint(r);
+    if (r->bad || r->len - r->pos <= len || r->data[r->pos + len] != '\0') {
+        r->bad = 1;
+        return NULL;
+    }
+    char *s = r->data + r->pos;
+    r->pos += len + 1;
+    return s;
+}
+
+// A NULL-terminated vector of n strings; each takes at least two bytes.
+static char **get_strv(reader_t *r, uint32_t n) {
+    if (r->bad || n > (r->len - r->pos) / 2) { r->bad = 1; return NULL; }
+    char **v = arena_alloc(r->arena, sizeof(char*) * (n + 1));
+    if (!v) { r->bad = 1; return NULL; }
+    for (uint32_t i = 0; i < n && !r->bad; i++) v[i] = get_str(r);
+    return v;
+}
+
+static command_t *get_node(reader_t *r) {
+    if (r->bad || r->pos >= r->len) { r->bad = 1; return NULL; }
+    command_t *cmd = arena_alloc(r->arena, sizeof(command_t));
+    if (!cmd) { r->bad = 1; return NULL; }
+    cmd->arena = r->arena;
+    cmd->type = (unsigned char)r->data[r->pos++];
+    if (cmd->type > CMD_TIME) r->bad = 1;
+    uint32_t mask = get_varint(r);
+    cmd->append_output = (mask & F_APPEND) != 0;
+    cmd->background = (mask & F_BACKGROUND) != 0;
+    if (mask & F_COMMAND) cmd->command = get_str(r);
+    if (mask & F_ARGS) {
+        cmd->arg_count = get_varint(r);
+        cmd->args = get_strv(r, cmd->arg_count);
+        if (cmd->args && (mask & F_COMMAND_ARG0)) cmd->command = cmd->args[0];
+        if (mask & F_QUOTED) {
+            if (r->bad || r->len - r->pos < (size_t)cmd->arg_count) { r->bad = 1; return NULL; }
+            cmd->quoted_args = (unsigned char *)r->data + r->pos;
+            r->pos += cmd->arg_count;
+        }
+    }
+    if (mask & F_INPUT) cmd->input_file = get_str(r);
+    if (mask & F_OUTPUT) cmd->output_file = get_str(r);
+    if (mask & F_FOR_VAR) cmd->for_variable = get_str(r);
+    if (mask & F_FOR_LIST) {
+        uint32_t n = get_varint(r);
+        cmd->for_list = get_strv(r, n);
+        if (mask & F_FOR_QUOTED) {
+            if (r->bad || r->len - r->pos < n) { r->bad = 1; return NULL; }
+            cmd->for_quoted = (unsigned char *)r->data + r->pos;
+            r->pos += n;
+        }
+    }
+    if (mask & F_CASE_EXPR) cmd->case_expression = get_str(r);
+    if (mask & F_CASE_ENTRIES) {
+        uint32_t n = get_varint(r);
+        if (r->bad || n > r->len - r->pos) { r->bad = 1; return NULL; }
+        cmd->case_entries = arena_alloc(r->arena, sizeof(case_entry_t*) * (n ? n : 1));
+        for (uint32_t i = 0; i < n && !r->bad; i++) {
+            case_entry_t *entry = arena_alloc(r->arena, sizeof(case_entry_t));
+            entry->pattern = get_str(r);
+            if (r->pos < r->len && r->data[r->pos++]) entry->body = get_node(r);
+            cmd->case_entries[i] = entry;
+            cmd->case_entry_count = i + 1;
+        }
+    }
+    for (int i = 0; i < CHILD_COUNT && !r->bad; i++)
+        if (mask & (F_CHILD << i)) *child_slot(cmd, i) = get_node(r);
+    return r->bad ? NULL : cmd;
+}
+
+// --- Cache files ---
+
+struct script_image_t {
+    // Cache hit: records are decoded from the mapped cache file.
+    char *data;
+    size_t len;
+    size_t pos;             // next record
+    size_t released;        // mapped bytes before this have been dropped
+    uint32_t remaining;     // records left
+    // Cache miss: commands are parsed as the script is read and their
+    // records appended to a temporary file, renamed into place at the end.
+    script_reader_t *reader;
+    int out;                // temporary cache file, or -1
+    buf_t pending;          // records not yet written
+    uint32_t records;
+    int finished;           // the reader reached the end of the script
+    unsigned long errors;   // parse_error_count() when the run started
+    cache_header_t header;
+    char cache_path[PATH_MAX];
+};
+
+// Temporary cache file being written and the run writing it. If the shell
+// exits before the script ends, the rest of the script is parsed into it
+// at exit. Only the process that created it touches it.
+static char pending_tmp[PATH_MAX];
+static pid_t pending_owner;
+static script_image_t *pending_image;
+
+static void finish_at_exit(void);
+
+static uint64_t fnv1a(const char *p, size_t n) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++)
+        hash = (hash ^ (unsigned char)p[i]) * 1099511628211ULL;
+    return hash;
+}
+
+static int pread_full(int fd, char *p, size_t n, off_t offset) {
+    while (n > 0) {
+        ssize_t got = pread(fd, p, n, offset);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        p += got;
+        n -= got;
+        offset += got;
+    }
+    return 0;
+}
+
+// Image checksum, eight bytes per step; catches truncated or damaged files.
+// The file is read in chunks rather than mapped, so checking a large image
+// does not leave all of it resident.
+static int checksum(int fd, off_t offset, size_t n, uint64_t *out) {
+    char chunk[64 * 1024];
+    uint64_t hash = n;
+    size_t done = 0;
+    while (n - done >= 8) {
+        size_t want = n - done < sizeof(chunk) ? (n - done) & ~(size_t)7 : sizeof(chunk);
+        if (pread_full(fd, chunk, want, offset + done) < 0) return -1;
+        for (size_t i = 0; i < want; i += 8) {
+            uint64_t word;
+            memcpy(&word, chunk + i, 8);
+            hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+            hash ^= hash >> 29;
+        }
+        done += want;
+    }
+    if (pread_full(fd, chunk, n - done, offset + done) < 0) return -1;
+    *out = hash ^ fnv1a(chunk, n - done);
+    return 0;
+}
+
+static void fill_header(cache_header_t *h, const struct stat *st, const char *path, uint32_t lines) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, CACHE_MAGIC, 4);
+    h->format = CACHE_FORMAT;
+    strncpy(h->version, JSHELL_VERSION, sizeof(h->version) - 1);
+    strncpy(h->parser_id, JSHELL_PARSER_ID, sizeof(h->parser_id) - 1);
+    h->dev = st->st_dev;
+    h->ino = st->st_ino;
+    h->mtime_sec = st->st_mtim.tv_sec;
+    h->mtime_nsec = st->st_mtim.tv_nsec;
+    h->size = st->st_size;
+    h->path_len = strlen(path);
+    h->line_count = lines;
+}
+
+// $XDG_CACHE_HOME/jshell/<FNV-1a of the absolute path>.jshc
+static int cache_file_path(const char *abs_path, char *out, size_t size) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char dir[PATH_MAX];
+    if (xdg && *xdg) snprintf(dir, sizeof(dir), "%s/jshell", xdg);
+    else if (home && *home) snprintf(dir, sizeof(dir), "%s/.cache/jshell", home);
+    else return -1;
+    uint64_t hash = fnv1a(abs_path, strlen(abs_path));
+    int n = snprintf(out, size, "%s/%016llx.jshc", dir, (unsigned long long)hash);
+    return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+static void make_cache_dir(const char *file) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", file);
+    char *slash = strrchr(dir, '/');
+    if (!slash) return;
+    *slash = '\0';
+    if (mkdir(dir, 0700) == 0 || errno != ENOENT) return;
+    // Create the parent ($HOME/.cache) first.
+    char *parent = strrchr(dir, '/');
+    if (!parent) return;
+    *parent = '\0';
+    mkdir(dir, 0700);
+    *parent = '/';
+    mkdir(dir, 0700);
+}
+
+// Maps a cache file if it matches the script; NULL if absent or stale.
+static script_image_t *load_cached(const char *cache_path, const struct stat *st, const char *abs_path) {
+    int fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat cst;
+    script_image_t *image = NULL;
+    if (fstat(fd, &cst) == 0 && (size_t)cst.st_size >= sizeof(cache_header_t)) {
+        // Private and writable: builtins may edit argument strings in place.
+        char *data = mmap(NULL, cst.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            cache_header_t want, have;
+            memcpy(&have, data, sizeof(have));
+            fill_header(&want, st, abs_path, have.line_count);
+            want.checksum = have.checksum;
+            size_t path_end = sizeof(have) + (size_t)have.path_len + 1;
+            uint64_t sum;
+            if (memcmp(&want, &have, sizeof(want)) == 0 &&
+                path_end <= (size_t)cst.st_size &&
+                memcmp(data + sizeof(have), abs_path, have.path_len + 1) == 0 &&
+                checksum(fd, sizeof(have), cst.st_size - sizeof(have), &sum) == 0 &&
+                sum == have.checksum) {
+                image = calloc(1, sizeof(script_image_t));
+            }
+            if (image) {
+                madvise(data, cst.st_size, MADV_SEQUENTIAL);
+                image->data = data;
+                image->len = cst.st_size;
+                image->pos = path_end;
+                image->remaining = have.line_count;
+            } else {
+                munmap(data, cst.st_size);
+                stat_stale++;
+            }
+        }
+    }
+    close(fd);
+    return image;
+}
+
+static int write_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t done = write(fd, p, n);
+        if (done < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += done;
+        n -= done;
+    }
+    return 0;
+}
+
+static void flush_pending(script_image_t *image) {
+    if (image->out < 0) return;
+    if (image->pending.failed || write_all(image->out, image->pending.data, image->pending.len) < 0)
+        image->pending.failed = 1;
+    image->pending.len = 0;
+}
+
+// Starts a run that parses the script as it goes. With a cache path, the
+// records are also written to a temporary file next to the cache entry.
+static script_image_t *stream(int fd, const struct stat *st, const char *abs_path,
+                              const char *cache_path) {
+    script_image_t *image = calloc(1, sizeof(script_image_t));
+    if (!image) return NULL;
+    image->reader = script_reader_fdopen(fd);
+    if (!image->reader) {
+        free(image);
+        return NULL;
+    }
+    image->out = -1;
+    image->errors = parse_error_count();
+    // One cache file is written at a time.
+    if (!cache_path || pending_tmp[0]) return image;
+    snprintf(pending_tmp, sizeof(pending_tmp), "%s.%d.tmp", cache_path, (int)getpid());
+    make_cache_dir(cache_path);
+    image->out = open(pending_tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (image->out < 0) {
+        stat_write_errors++;
+        pending_tmp[0] = '\0';
+        return image;
+    }
+    static int registered = 0;
+    if (!registered) registered = atexit(finish_at_exit) == 0;
+    pending_owner = getpid();
+    pending_image = image;
+    snprintf(image->cache_path, sizeof(image->cache_path), "%s", cache_path);
+    fill_header(&image->header, st, abs_path, 0);
+    put(&image->pending, &image->header, sizeof(image->header));
+    put(&image->pending, abs_path, image->header.path_len + 1);
+    return image;
+}
+
+// Completes the cache file: the header's record count and checksum are
+// filled in and the file is renamed into place, so readers never see a
+// partial image. Parse diagnostics are printed while parsing, so scripts
+// that had any are not cached: a cached run could not repeat them.
+static void finish_cache(script_image_t *image) {
+    if (image->out < 0) return;
+    int wanted = image->finished && parse_error_count() == image->errors;
+    int ok = wanted;
+    if (ok) {
+        flush_pending(image);
+        ok = !image->pending.failed;
+    }
+    if (ok) {
+        off_t size = lseek(image->out, 0, SEEK_END);
+        size_t body = sizeof(cache_header_t);
+        image->header.line_count = image->records;
+        ok = size > (off_t)body &&
+             checksum(image->out, body, size - body, &image->header.checksum) == 0 &&
+             pwrite(image->out, &image->header, body, 0) == (ssize_t)body;
+    }
+    if (close(image->out) == 0 && ok && rename(pending_tmp, image->cache_path) == 0) {
+        stat_writes++;
+    } else {
+        unlink(pending_tmp);
+        if (wanted) stat_write_errors++;
+    }
+    image->out = -1;
+    pending_tmp[0] = '\0';
+    pending_image = NULL;
+}
+
+script_image_t *script_image_open(const char *filename) {
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    char abs_path[PATH_MAX];
+    if (!realpath(filename, abs_path))
+        snprintf(abs_path, sizeof(abs_path), "%s", filename);
+    char cache_path[PATH_MAX];
+    int have_cache = cache_file_path(abs_path, cache_path, sizeof(cache_path)) == 0;
+    script_image_t *image = have_cache ? load_cached(cache_path, &st, abs_path) : NULL;
+    if (image) {
+        stat_hits++;
+        close(fd);
+        return image;
+    }
+    stat_misses++;
+    image = stream(fd, &st, abs_path, have_cache ? cache_path : NULL);
+    if (!image) {
+        close(fd);
+        errno = ENOMEM;
+    }
+    return image;
+}
+
+static int next_streamed(script_image_t *image, command_t **cmd, int *line_num) {
+    char *text = script_reader_next(image->reader, line_num);
+    if (!text) {
+        image->finished = 1;
+        return 0;
+    }
+    *cmd = parse_input(text);
+    if (image->out >= 0) {
+        unsigned char parsed = *cmd != NULL;
+        put_varint(&image->pending, *line_num);
+        put(&image->pending, &parsed, 1);
+        if (*cmd) put_node(&image->pending, *cmd);
+        image->records++;
+        if (image->pending.len >= FLUSH_SIZE) flush_pending(image);
+    }
+    return 1;
+}
+
+// The script called exit (or the shell otherwise exited) part way through:
+// parse what is left so the next run still finds a complete entry. The
+// lines are never run, so their diagnostics are not printed, and the first
+// one that fails to parse abandons the entry.
+static void finish_at_exit(void) {
+    script_image_t *image = pending_image;
+    if (!image || getpid() != pending_owner) return;
+    parse_quiet = 1;
+    command_t *cmd;
+    int line_num;
+    while (parse_error_count() == image->errors && next_streamed(image, &cmd, &line_num))
+        if (cmd) command_free(cmd);
+    finish_cache(image);
+}
+
+// Earlier records' trees have been freed, so the pages behind the current
+// record are dropped rather than left resident for the rest of the run.
+static void release_behind(script_image_t *image) {
+    size_t upto = image->pos & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+    if (upto - image->released < RELEASE_STEP) return;
+    madvise(image->data + image->released, upto - image->released, MADV_DONTNEED);
+    image->released = upto;
+}
+
+int script_image_next(script_image_t *image, command_t **cmd, int *line_num) {
+    if (image->reader) return next_streamed(image, cmd, line_num);
+    if (image->remaining == 0) return 0;
+    release_behind(image);
+    image->remaining--;
+    reader_t r = { image->data, image->len, image->pos, 0, NULL };
+    *line_num = get_varint(&r);
+    *cmd = NULL;
+    if (r.pos < r.len && r.data[r.pos++] && (r.arena = arena_create())) {
+        *cmd = get_node(&r);
+        if (*cmd) (*cmd)->arena_root = 1;
+        else arena_destroy(r.arena);
+    }
+    // A damaged record ends the image rather than misreading the rest.
+    if (r.bad) image->remaining = 0;
+    image->pos = r.pos;
+    return 1;
+}
+
+void script_image_close(script_image_t *image) {
+    if (!image) return;
+    if (image->reader) {
+        finish_cache(image);
+        script_reader_close(image->reader);
+        free(image->pending.data);
+    } else {
+        munmap(image->data, image->len);
+    }
+    free(image);
+}
+
+void script_cache_report(void) {
+    fprintf(stderr, "script-cache: %lu hits, %lu misses (%lu stale), %lu writes, %lu write errors\n",
+            stat_hits, stat_misses, stat_stale, stat_writes, stat_write_errors);
+}
@@ -0,0 +1,55 @@
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include "command.h"
+
+// Compiled .jsh scripts: every command's parse tree serialized into one image.
+// Images are cached as $XDG_CACHE_HOME/jshell/<hash of path>.jshc (default
+// ~/.cache/jshell) and keyed by path, device, inode, mtime, size, the
+// jshell version and a checksum of the parser's sources, so a later run of
+// the same build maps the image instead of re-parsing.
+typedef struct script_image_t script_image_t;
+
+extern int script_cache_enabled;    // cleared by --no-script-cache
+
+/**
+ * Opens a script as a compiled image.
+ * A valid cache entry is mmap'd. Otherwise the script is streamed: each
+ * command is parsed as it is read and its record appended to a new cache
+ * entry, which is kept if the whole script parses without errors. A script
+ * that exits early has its remaining lines parsed into the entry at exit.
+ * @param filename Script path
+ * @return Image, or NULL with errno set if the script cannot be read
+ * @pre filename is non-NULL
+ * @post Caller releases the image with script_image_close()
+ */
+script_image_t *script_image_open(const char *filename);
+
+/**
+ * Returns the next command's tree, rebuilt from the image or parsed.
+ * Strings in a rebuilt tree point into the image, and the pages behind
+ * the current record are released, so free each tree before the next
+ * call; command_copy() makes an independent copy.
+ * @param image Image from script_image_open()
+ * @param cmd Set to the tree (free with command_free()), or NULL if the
+ *            command failed to parse
+ * @param line_num Set to the line the command starts on
+ * @return 1 if a line was read, 0 at the end of the script
+ * @pre image is non-NULL
+ */
+int script_image_next(script_image_t *image, command_t **cmd, int *line_num);
+
+/**
+ * Unmaps an image, or finishes a streamed run and its cache entry.
+ * @param image Image to close, may be NULL
+ * @post Trees still pointing into the image are invalid
+ */
+void script_image_close(script_image_t *image);
+
+/**
+ * Prints hit/miss counters to stderr (--script-cache-stats).
+ * @pre None
+ */
+void script_cache_report(void);
+
+#endif
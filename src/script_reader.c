@@ -0,0 +1,118 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "shell.h"
+#include "script_reader.h"
+
+#define READ_CHUNK (256 * 1024)
+
+struct script_reader_t {
+    int fd;
+    char *buf;          // cap bytes plus one for a terminating NUL
+    size_t cap;
+    size_t start;       // first byte of the command being assembled
+    size_t scan;        // first byte not yet scanned
+    size_t end;         // bytes read into buf
+    int eof;
+    int line_num;       // lines consumed so far
+};
+
+script_reader_t *script_reader_fdopen(int fd) {
+    script_reader_t *reader = calloc(1, sizeof(script_reader_t));
+    if (!reader) return NULL;
+    reader->buf = malloc(READ_CHUNK + 1);
+    if (!reader->buf) {
+        free(reader);
+        return NULL;
+    }
+    reader->cap = READ_CHUNK;
+    reader->fd = fd;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return reader;
+}
+
+script_reader_t *script_reader_open(const char *filename) {
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    script_reader_t *reader = script_reader_fdopen(fd);
+    if (!reader) close(fd);
+    return reader;
+}
+
+// Drops the consumed text before the current command, grows the buffer
+// when the command fills it, and reads the next chunk. Returns 0 once the
+// file is exhausted.
+static int fill(script_reader_t *reader) {
+    if (reader->start > 0) {
+        memmove(reader->buf, reader->buf + reader->start, reader->end - reader->start);
+        reader->scan -= reader->start;
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (reader->end == reader->cap) {
+        char *grown = realloc(reader->buf, reader->cap * 2 + 1);
+        if (!grown) {
+            reader->eof = 1;
+            return 0;
+        }
+        reader->buf = grown;
+        reader->cap *= 2;
+    }
+    ssize_t n;
+    do {
+        n = read(reader->fd, reader->buf + reader->end, reader->cap - reader->end);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        reader->eof = 1;
+        return 0;
+    }
+    reader->end += n;
+    return 1;
+}
+
+static int is_blank(const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        if (s[i] != ' ' && s[i] != '\t' && s[i] != '\r') return 0;
+    return 1;
+}
+
+char *script_reader_next(script_reader_t *reader, int *line_num) {
+    parse_state_t state = { 0 };
+    size_t cmd_len = 0;
+    int lines = 0;
+    reader->start = reader->scan;
+    for (;;) {
+        char *newline = memchr(reader->buf + reader->scan, '\n', reader->end - reader->scan);
+        if (!newline && !reader->eof && fill(reader)) continue;
+        size_t line_end = newline ? (size_t)(newline - reader->buf) : reader->end;
+        if (!newline && line_end == reader->scan) break;
+        // An unterminated last line still ends in a NUL for the scanner.
+        if (!newline) reader->buf[line_end] = '\0';
+        char *line = reader->buf + reader->scan;
+        size_t len = line_end - reader->scan;
+        reader->line_num++;
+        reader->scan = newline ? line_end + 1 : line_end;
+        int complete = parse_scan_line(&state, line, len);
+        if (lines == 0 && complete && is_blank(line, len)) {
+            reader->start = reader->scan;
+            continue;
+        }
+        if (lines++ == 0) *line_num = reader->line_num;
+        cmd_len = line_end - reader->start;
+        if (complete) break;
+    }
+    if (lines == 0) return NULL;
+    reader->buf[reader->start + cmd_len] = '\0';
+    return reader->buf + reader->start;
+}
+
+void script_reader_close(script_reader_t *reader) {
+    if (!reader) return;
+    close(reader->fd);
+    free(reader->buf);
+    free(reader);
+}
@@ -0,0 +1,46 @@
+#ifndef SCRIPT_READER_H
+#define SCRIPT_READER_H
+
+// Streams a script as complete commands. The file is read in large chunks
+// into one buffer, which only grows to fit the longest command, so memory
+// stays flat however long the script is. A command spans lines while an
+// if/while/for/case, a ( group or a quote is open, or while a line ends in
+// |, &&, || or a backslash (see parse_scan_line()).
+typedef struct script_reader_t script_reader_t;
+
+/**
+ * Opens a script for reading.
+ * @param filename Script path
+ * @return Reader, or NULL with errno set
+ * @pre filename is non-NULL
+ * @post Caller releases the reader with script_reader_close()
+ */
+script_reader_t *script_reader_open(const char *filename);
+
+/**
+ * Wraps an open descriptor, which the reader then owns and closes.
+ * @param fd Descriptor positioned at the start of the script
+ * @return Reader, or NULL if out of memory (fd is left open)
+ * @pre fd is readable
+ */
+script_reader_t *script_reader_fdopen(int fd);
+
+/**
+ * Returns the next command, skipping blank and comment lines. Its lines
+ * are joined by newlines, which the parser treats as separators.
+ * @param reader Reader from script_reader_open()
+ * @param line_num Set to the line the command starts on
+ * @return NUL-terminated text valid until the next call, or NULL at the
+ *         end of the script. A construct still open at the end is returned
+ *         as it is.
+ * @pre reader is non-NULL
+ */
+char *script_reader_next(script_reader_t *reader, int *line_num);
+
+/**
+ * Closes the descriptor and frees the buffer.
+ * @param reader Reader to close, may be NULL
+ */
+void script_reader_close(script_reader_t *reader);
+
+#endif
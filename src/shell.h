@@ -11,6 +11,12 @@
 // Current command being executed
 extern char current_command[MAX_CMD_LEN];
 
+// Non-zero when stdin is a terminal and the shell manages process groups
+extern int job_control_enabled;
+
+// Non-zero in a forked ( ... ) child running jshell code without exec
+extern int in_subshell;
+
 /**
  * Reads a line of input from the user.
  * @return Allocated string containing input, NULL on EOF/error
@@ -24,10 +30,46 @@ char *read_input(void);
  * @param input The input string to parse
  * @return Parsed command structure or NULL on error
  * @pre input is a valid string
- * @post Returns malloc'd command structure that caller must free
+ * @post Returns a tree allocated from its own arena; free it with command_free()
  */
 command_t *parse_input(char *input);
 
+// Nesting carried from one script line to the next by parse_scan_line().
+typedef struct {
+    int depth;          // open if/while/for/case constructs
+    int parens;         // open ( groups
+    char quote;         // quote left open at the end of the line, or 0
+    int continued;      // line ended in |, &&, || or a backslash
+} parse_state_t;
+
+/**
+ * Scans one physical script line and updates the nesting state, so a
+ * reader knows when a multi-line command is complete. Whole-line comments
+ * and a trailing backslash are blanked out in place.
+ * @param state State for the command being read, zeroed before its first line
+ * @param line Line without its newline
+ * @param len Length of line
+ * @return 1 if the lines so far form a complete command, 0 if more are needed
+ * @pre line[len] is readable and is '\n' or '\0'
+ */
+int parse_scan_line(parse_state_t *state, char *line, size_t len);
+
+/**
+ * Number of lines parse_input() has been called on, for --alloc-stats.
+ * @return Lines parsed so far
+ * @pre None
+ */
+unsigned long parsed_line_count(void);
+
+/**
+ * Number of diagnostics parse_input() has printed, such as a missing ')'.
+ * @return Errors reported so far
+ * @pre None
+ */
+unsigned long parse_error_count(void);
+
+extern int parse_quiet;     // count parse errors without printing them
+
 /**
  * Executes a single command.
  * @param cmd The command structure to execute
@@ -36,6 +78,15 @@ command_t *parse_input(char *input);
  */
 void execute_command(command_t *cmd);
 
+/**
+ * Executes a leaf of a compiled program: a simple command, pipeline,
+ * subshell or time keyword, including alias expansion.
+ * @param cmd The command structure to execute
+ * @pre cmd is non-NULL and not a compound command
+ * @post cmd->last_status holds the command's exit status
+ */
+void execute_simple(command_t *cmd);
+
 /**
  * Executes two commands connected by a pipe.
  * @param left Left side of pipe
@@ -45,6 +96,12 @@ void execute_command(command_t *cmd);
  */
 void execute_pipe(command_t *left, command_t *right);
 
+/**
+ * Prints the prompt for the current directory.
+ * @post current_prompt holds the text that was printed
+ */
+void print_prompt(void);
+
 /**
  * Sets the current foreground process.
  * @param pid Process ID to set as foreground
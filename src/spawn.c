@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include "spawn.h"
+#include "glob.h"
+#include "options.h"
+
+extern char **environ;
+
+// Signals the shell may ignore or catch that children must see as default.
+static const int default_signals[] = {
+    SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD
+};
+
+static char *expand_word(const char *word) {
+    if (word[0] != '$') return (char *)word;
+    char *val = getenv(word + 1);
+    return val ? val : "";
+}
+
+static int is_pattern(const command_t *cmd, int i) {
+    return cmd->args[i][0] != '$' && !(cmd->quoted_args && cmd->quoted_args[i]) &&
+           glob_has_magic(cmd->args[i]);
+}
+
+#define NOT_A_PATTERN ((size_t)-1)
+
+// Builds argv with each pattern replaced by its matches. The vector and the
+// matched paths share one allocation, so callers still free only argv.
+static char **expand_patterns(command_t *cmd, int *argc) {
+    glob_matches_t matches = { 0 };
+    size_t *found = malloc(sizeof(size_t) * cmd->arg_count);
+    if (!found) return NULL;
+    size_t words = 0;
+    for (int i = 0; i < cmd->arg_count; i++) {
+        found[i] = is_pattern(cmd, i) ? glob_expand(cmd->args[i], &matches) : NOT_A_PATTERN;
+        // A pattern with no match stays as written, unless nullglob drops
+        // it; the command word is always kept.
+        if (found[i] == 0 && opt_nullglob && i > 0) continue;
+        words += (found[i] == 0 || found[i] == NOT_A_PATTERN) ? 1 : found[i];
+    }
+    char **argv = NULL;
+    if (!matches.failed)
+        argv = malloc(sizeof(char*) * (words + 1) + matches.pool_len);
+    if (argv) {
+        char *pool = (char *)(argv + words + 1);
+        if (matches.pool_len) memcpy(pool, matches.pool, matches.pool_len);
+        size_t n = 0, next = 0;
+        for (int i = 0; i < cmd->arg_count; i++) {
+            if (found[i] == 0 && opt_nullglob && i > 0) continue;
+            if (found[i] == 0 || found[i] == NOT_A_PATTERN) {
+                argv[n++] = expand_word(cmd->args[i]);
+                continue;
+            }
+            for (size_t k = 0; k < found[i]; k++)
+                argv[n++] = pool + matches.offsets[next++];
+        }
+        argv[n] = NULL;
+        if (argc) *argc = n;
+    }
+    free(found);
+    glob_matches_free(&matches);
+    return argv;
+}
+
+char **expand_command_args(command_t *cmd, int *argc) {
+    if (!opt_noglob)
+        for (int i = 0; i < cmd->arg_count; i++)
+            if (is_pattern(cmd, i)) return expand_patterns(cmd, argc);
+    char **argv = malloc(sizeof(char*) * (cmd->arg_count + 1));
+    if (!argv) return NULL;
+    for (int i = 0; i < cmd->arg_count; i++)
+        argv[i] = expand_word(cmd->args[i]);
+    argv[cmd->arg_count] = NULL;
+    if (argc) *argc = cmd->arg_count;
+    return argv;
+}
+
+void reset_child_signals(const sigset_t *child_mask) {
+    for (size_t i = 0; i < sizeof(default_signals) / sizeof(default_signals[0]); i++)
+        signal(default_signals[i], SIG_DFL);
+    if (child_mask) sigprocmask(SIG_SETMASK, child_mask, NULL);
+}
+
+static int output_flags(command_t *cmd) {
+    return O_CREAT | O_WRONLY | (cmd->append_output ? O_APPEND : O_TRUNC);
+}
+
+// Fast path: posix_spawn. Returns 0 and sets *pid, or an errno value.
+static int try_posix_spawn(command_t *cmd, const char *path, char *const argv[],
+                           int new_pgroup, const sigset_t *child_mask, pid_t *pid) {
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    sigset_t defaults;
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+    int err;
+
+    if ((err = posix_spawnattr_init(&attr)) != 0) return err;
+    if ((err = posix_spawn_file_actions_init(&actions)) != 0) {
+        posix_spawnattr_destroy(&attr);
+        return err;
+    }
+    sigemptyset(&defaults);
+    for (size_t i = 0; i < sizeof(default_signals) / sizeof(default_signals[0]); i++)
+        sigaddset(&defaults, default_signals[i]);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, child_mask);
+    if (new_pgroup) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, 0);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    if (cmd->output_file)
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, cmd->output_file,
+                                         output_flags(cmd), 0644);
+    if (cmd->input_file)
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, cmd->input_file,
+                                         O_RDONLY, 0);
+
+    err = posix_spawn(pid, path, &actions, &attr, argv, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    return err;
+}
+
+void exec_command(const char *path, char *const argv[]) {
+    execv(path, argv);
+    if (errno == ENOEXEC) {
+        // No #! line: run it as a sh script, like execvp() does.
+        size_t argc = 0;
+        while (argv[argc]) argc++;
+        char **sh_argv = malloc(sizeof(char*) * (argc + 2));
+        if (sh_argv) {
+            sh_argv[0] = "sh";
+            sh_argv[1] = (char *)path;
+            for (size_t i = 1; i <= argc; i++) sh_argv[i + 1] = argv[i];
+            execv("/bin/sh", sh_argv);
+        }
+    }
+    if (errno == ENOENT) {
+        fprintf(stderr, "%s: command not found\n", argv[0]);
+        _exit(127);
+    }
+    fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+    _exit(126);
+}
+
+// Slow path: classic fork + exec, with error reporting from the child.
+static pid_t fork_command(command_t *cmd, const char *path, char *const argv[],
+                          int new_pgroup, const sigset_t *child_mask) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (new_pgroup) setpgid(0, 0);
+        reset_child_signals(child_mask);
+
+        if (cmd->output_file != NULL) {
+            int fd_out = open(cmd->output_file, output_flags(cmd), 0644);
+            if (fd_out < 0) { perror(cmd->output_file); _exit(EXIT_FAILURE); }
+            dup2(fd_out, STDOUT_FILENO);
+            close(fd_out);
+        }
+        if (cmd->input_file != NULL) {
+            int fd_in = open(cmd->input_file, O_RDONLY);
+            if (fd_in < 0) { perror(cmd->input_file); _exit(EXIT_FAILURE); }
+            dup2(fd_in, STDIN_FILENO);
+            close(fd_in);
+        }
+        exec_command(path, argv);
+    }
+    if (pid > 0 && new_pgroup) setpgid(pid, pid);
+    return pid;
+}
+
+pid_t spawn_command(command_t *cmd, const char *path, char *const argv[],
+                    int new_pgroup, const sigset_t *child_mask) {
+    const char *mode = getenv("JSHELL_SPAWN");
+    if (!mode || strcmp(mode, "fork") != 0) {
+        pid_t pid;
+        if (try_posix_spawn(cmd, path, argv, new_pgroup, child_mask, &pid) == 0)
+            return pid;
+    }
+    return fork_command(cmd, path, argv, new_pgroup, child_mask);
+}
@@ -0,0 +1,61 @@
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <signal.h>
+#include <sys/types.h>
+#include "command.h"
+
+/**
+ * Builds the argument vector for an external command.
+ * Arguments of the form $VAR are replaced by the variable's value (or "").
+ * Unquoted words with *, ? or [ are replaced by the sorted paths they
+ * match (see glob.h); set -f turns this off and nullglob drops patterns
+ * that match nothing.
+ * @param cmd Command whose args are expanded
+ * @param argc Set to the number of arguments, may be NULL
+ * @return malloc'd NULL-terminated vector, NULL on error. It borrows cmd's
+ *         strings; matched paths live in the same allocation.
+ * @pre cmd is a simple command with args[0] set
+ * @post cmd is not modified; caller frees only the returned array
+ */
+char **expand_command_args(command_t *cmd, int *argc);
+
+/**
+ * Restores default dispositions for the signals the shell handles.
+ * @param child_mask Signal mask to install, or NULL to keep the current one
+ * @pre Called in a freshly forked child
+ * @post SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU and SIGCHLD are SIG_DFL
+ */
+void reset_child_signals(const sigset_t *child_mask);
+
+/**
+ * Replaces the process with a command, as execvp() would once the path is
+ * known: a file with no #! line is run by /bin/sh.
+ * @param path Executable to run, as resolved by path_cache_lookup()
+ * @param argv Argument vector, argv[0] naming the command in errors
+ * @pre Called in a child process; path and argv[0] are non-NULL
+ * @post Never returns: on failure the error is reported and the child
+ *       exits 127 if the file does not exist, 126 otherwise
+ */
+void exec_command(const char *path, char *const argv[]);
+
+/**
+ * Starts an external command.
+ * Uses posix_spawn (clone(CLONE_VM|CLONE_VFORK) under glibc) with spawn
+ * attributes for signal defaults and process group, and file actions for
+ * the command's redirections. Falls back to fork() when spawning fails so
+ * that redirection and exec errors are reported from the child as before,
+ * or when JSHELL_SPAWN=fork is set.
+ * @param cmd Command supplying input_file/output_file/append_output
+ * @param path Executable to run, as resolved by path_cache_lookup()
+ * @param argv Argument vector from expand_command_args()
+ * @param new_pgroup 1 to put the child in its own process group
+ * @param child_mask Signal mask the child should start with
+ * @return Child pid, or -1 if no process could be created
+ * @pre path and argv[0] are non-NULL
+ * @post On success the child is running the command
+ */
+pid_t spawn_command(command_t *cmd, const char *path, char *const argv[],
+                    int new_pgroup, const sigset_t *child_mask);
+
+#endif
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "shell.h"
+
+// Recursive-descent evaluator for test / [ expressions:
+//   expr    := and_expr [ -o expr ]
+//   and_expr:= not_expr [ -a and_expr ]
+//   not_expr:= ! not_expr | primary
+//   primary := ( expr ) | unary-op arg | arg binary-op arg | arg
+
+typedef struct {
+    char **argv;
+    int argc;
+    int pos;
+    int error;
+    const char *name;
+} test_state_t;
+
+static const char *unary_ops[] = {
+    "-b", "-c", "-d", "-e", "-f", "-g", "-h", "-k", "-L", "-n", "-p",
+    "-r", "-s", "-S", "-t", "-u", "-w", "-x", "-z", NULL
+};
+
+static const char *binary_ops[] = {
+    "=", "==", "!=", "<", ">", "-eq", "-ne", "-gt", "-ge", "-lt", "-le",
+    "-nt", "-ot", "-ef", NULL
+};
+
+static int in_list(const char *s, const char **list) {
+    for (int i = 0; list[i]; i++)
+        if (strcmp(s, list[i]) == 0) return 1;
+    return 0;
+}
+
+static int is_binary_at(test_state_t *st, int pos) {
+    return pos + 2 < st->argc && in_list(st->argv[pos + 1], binary_ops);
+}
+
+static void test_error(test_state_t *st, const char *msg, const char *arg) {
+    if (!st->error) {
+        if (arg) fprintf(stderr, "%s: %s: %s\n", st->name, arg, msg);
+        else fprintf(stderr, "%s: %s\n", st->name, msg);
+    }
+    st->error = 1;
+}
+
+static long long to_int(test_state_t *st, const char *s) {
+    char *end;
+    errno = 0;
+    long long v = strtoll(s, &end, 10);
+    while (*end == ' ' || *end == '\t') end++;
+    if (*s == '\0' || *end != '\0' || errno == ERANGE) {
+        test_error(st, "integer expression expected", s);
+        return 0;
+    }
+    return v;
+}
+
+static int file_test(char op, const char *path) {
+    struct stat sb;
+    if (op == 'h' || op == 'L')
+        return lstat(path, &sb) == 0 && S_ISLNK(sb.st_mode);
+    if (op == 't')
+        return isatty(atoi(path));
+    if (stat(path, &sb) != 0) return 0;
+    switch (op) {
+        case 'b': return S_ISBLK(sb.st_mode);
+        case 'c': return S_ISCHR(sb.st_mode);
+        case 'd': return S_ISDIR(sb.st_mode);
+        case 'e': return 1;
+        case 'f': return S_ISREG(sb.st_mode);
+        case 'g': return (sb.st_mode & S_ISGID) != 0;
+        case 'k': return (sb.st_mode & S_ISVTX) != 0;
+        case 'p': return S_ISFIFO(sb.st_mode);
+        case 'r': return access(path, R_OK) == 0;
+        case 's': return sb.st_size > 0;
+        case 'S': return S_ISSOCK(sb.st_mode);
+        case 'u': return (sb.st_mode & S_ISUID) != 0;
+        case 'w': return access(path, W_OK) == 0;
+        case 'x': return access(path, X_OK) == 0;
+    }
+    return 0;
+}
+
+static int unary(const char *op, const char *arg) {
+    if (strcmp(op, "-n") == 0) return arg[0] != '\0';
+    if (strcmp(op, "-z") == 0) return arg[0] == '\0';
+    return file_test(op[1], arg);
+}
+
+static int binary(test_state_t *st, const char *a, const char *op, const char *b) {
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) return strcmp(a, b) == 0;
+    if (strcmp(op, "!=") == 0) return strcmp(a, b) != 0;
+    if (strcmp(op, "<") == 0) return strcmp(a, b) < 0;
+    if (strcmp(op, ">") == 0) return strcmp(a, b) > 0;
+    if (strcmp(op, "-nt") == 0 || strcmp(op, "-ot") == 0 || strcmp(op, "-ef") == 0) {
+        struct stat sa, sb;
+        int ha = stat(a, &sa) == 0, hb = stat(b, &sb) == 0;
+        if (op[1] == 'e') return ha && hb && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+        if (!ha || !hb) return (op[1] == 'n') ? (ha && !hb) : (!ha && hb);
+        long long ta = sa.st_mtim.tv_sec * 1000000000LL + sa.st_mtim.tv_nsec;
+        long long tb = sb.st_mtim.tv_sec * 1000000000LL + sb.st_mtim.tv_nsec;
+        return (op[1] == 'n') ? ta > tb : ta < tb;
+    }
+    long long x = to_int(st, a), y = to_int(st, b);
+    if (strcmp(op, "-eq") == 0) return x == y;
+    if (strcmp(op, "-ne") == 0) return x != y;
+    if (strcmp(op, "-gt") == 0) return x > y;
+    if (strcmp(op, "-ge") == 0) return x >= y;
+    if (strcmp(op, "-lt") == 0) return x < y;
+    return x <= y;
+}
+
+static int parse_expr(test_state_t *st);
+
+static int parse_primary(test_state_t *st) {
+    if (st->pos >= st->argc) {
+        test_error(st, "argument expected", NULL);
+        return 0;
+    }
+    char *tok = st->argv[st->pos];
+    if (is_binary_at(st, st->pos)) {
+        char *op = st->argv[st->pos + 1];
+        char *rhs = st->argv[st->pos + 2];
+        st->pos += 3;
+        return binary(st, tok, op, rhs);
+    }
+    if (strcmp(tok, "(") == 0 && st->pos + 1 < st->argc) {
+        st->pos++;
+        int v = parse_expr(st);
+        if (st->pos >= st->argc || strcmp(st->argv[st->pos], ")") != 0) {
+            test_error(st, "')' expected", NULL);
+            return 0;
+        }
+        st->pos++;
+        return v;
+    }
+    if (in_list(tok, unary_ops) && st->pos + 1 < st->argc) {
+        st->pos += 2;
+        return unary(tok, st->argv[st->pos - 1]);
+    }
+    st->pos++;
+    return tok[0] != '\0';
+}
+
+static int parse_not(test_state_t *st) {
+    if (st->pos < st->argc && strcmp(st->argv[st->pos], "!") == 0 &&
+        st->pos + 1 < st->argc && !is_binary_at(st, st->pos)) {
+        st->pos++;
+        return !parse_not(st);
+    }
+    return parse_primary(st);
+}
+
+static int parse_and(test_state_t *st) {
+    int v = parse_not(st);
+    while (st->pos < st->argc && strcmp(st->argv[st->pos], "-a") == 0) {
+        st->pos++;
+        int rhs = parse_not(st);
+        v = v && rhs;
+    }
+    return v;
+}
+
+static int parse_expr(test_state_t *st) {
+    int v = parse_and(st);
+    while (st->pos < st->argc && strcmp(st->argv[st->pos], "-o") == 0) {
+        st->pos++;
+        int rhs = parse_and(st);
+        v = v || rhs;
+    }
+    return v;
+}
+
+// test / [ command: 0 if the expression is true, 1 if false, 2 on error
+int cmd_test(command_t *cmd) {
+    test_state_t st = { cmd->args + 1, cmd->arg_count - 1, 0, 0, cmd->args[0] };
+    if (strcmp(cmd->args[0], "[") == 0) {
+        if (st.argc < 1 || strcmp(st.argv[st.argc - 1], "]") != 0) {
+            fprintf(stderr, "[: missing ]\n");
+            return 2;
+        }
+        st.argc--;
+    }
+    if (st.argc == 0) return 1;
+    int result = parse_expr(&st);
+    if (!st.error && st.pos < st.argc)
+        test_error(&st, "unexpected argument", st.argv[st.pos]);
+    if (st.error) return 2;
+    return result ? 0 : 1;
+}
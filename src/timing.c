@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "timing.h"
+
+// Report line layout, overridable with JSHELL_TIMEFORMAT:
+//   %n name   %R wall s   %U user s   %S sys s
+//   %M max RSS KiB   %w voluntary / %c involuntary context switches   %% %
+// The last line uses the name "total" and covers the shell itself plus
+// every child it waited for.
+#define DEFAULT_TIMEFORMAT "%n\treal %Rs\tuser %Us\tsys %Ss\tmaxrss %MKB\tcsw %w/%c"
+
+typedef struct {
+    pid_t pid;
+    char *name;
+    struct timespec start;
+    double wall;
+    struct rusage usage;
+    int reaped;
+} stage_t;
+
+static int active = 0;
+static stage_t *stages = NULL;
+static int stage_count = 0;
+static int stage_cap = 0;
+static struct timespec begin_time;
+static struct rusage begin_self;
+static struct rusage begin_children;
+
+static double seconds_between(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+static double tv_seconds(const struct timeval *tv) {
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+int timing_begin(void) {
+    if (active) return 0;
+    active = 1;
+    stage_count = 0;
+    getrusage(RUSAGE_SELF, &begin_self);
+    getrusage(RUSAGE_CHILDREN, &begin_children);
+    clock_gettime(CLOCK_MONOTONIC, &begin_time);
+    return 1;
+}
+
+void timing_launch(pid_t pid, const char *name) {
+    if (!active) return;
+    if (stage_count == stage_cap) {
+        int cap = stage_cap ? stage_cap * 2 : 8;
+        stage_t *grown = realloc(stages, sizeof(stage_t) * cap);
+        if (!grown) return;
+        stages = grown;
+        stage_cap = cap;
+    }
+    stage_t *st = &stages[stage_count++];
+    memset(st, 0, sizeof(*st));
+    st->pid = pid;
+    st->name = strdup(name ? name : "?");
+    clock_gettime(CLOCK_MONOTONIC, &st->start);
+}
+
+void timing_reaped(pid_t pid, const struct rusage *usage) {
+    if (!active) return;
+    for (int i = stage_count - 1; i >= 0; i--) {
+        if (stages[i].pid != pid || stages[i].reaped) continue;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        stages[i].wall = seconds_between(&stages[i].start, &now);
+        stages[i].usage = *usage;
+        stages[i].reaped = 1;
+        return;
+    }
+}
+
+static void print_line(FILE *out, const char *fmt, const char *name, double wall,
+                       double user, double sys, long maxrss, long nvcsw, long nivcsw) {
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%' || !p[1]) {
+            fputc(*p, out);
+            continue;
+        }
+        switch (*++p) {
+            case 'n': fputs(name, out); break;
+            case 'R': fprintf(out, "%.3f", wall); break;
+            case 'U': fprintf(out, "%.3f", user); break;
+            case 'S': fprintf(out, "%.3f", sys); break;
+            case 'M': fprintf(out, "%ld", maxrss); break;
+            case 'w': fprintf(out, "%ld", nvcsw); break;
+            case 'c': fprintf(out, "%ld", nivcsw); break;
+            case '%': fputc('%', out); break;
+            default: fputc('%', out); fputc(*p, out); break;
+        }
+    }
+    fputc('\n', out);
+}
+
+void timing_end(void) {
+    if (!active) return;
+    active = 0;
+    struct timespec now;
+    struct rusage self, children;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    const char *fmt = getenv("JSHELL_TIMEFORMAT");
+    if (!fmt || !*fmt) fmt = DEFAULT_TIMEFORMAT;
+
+    // Build the whole report first so it reaches stderr in one write.
+    char *report = NULL;
+    size_t report_len = 0;
+    FILE *out = open_memstream(&report, &report_len);
+    if (!out) return;
+    long maxrss = self.ru_maxrss;
+    for (int i = 0; i < stage_count; i++) {
+        const struct rusage *ru = &stages[i].usage;
+        if (stages[i].reaped) {
+            print_line(out, fmt, stages[i].name, stages[i].wall,
+                       tv_seconds(&ru->ru_utime), tv_seconds(&ru->ru_stime),
+                       ru->ru_maxrss, ru->ru_nvcsw, ru->ru_nivcsw);
+            if (ru->ru_maxrss > maxrss) maxrss = ru->ru_maxrss;
+        }
+        free(stages[i].name);
+    }
+    stage_count = 0;
+    double user = tv_seconds(&self.ru_utime) - tv_seconds(&begin_self.ru_utime) +
+                  tv_seconds(&children.ru_utime) - tv_seconds(&begin_children.ru_utime);
+    double sys = tv_seconds(&self.ru_stime) - tv_seconds(&begin_self.ru_stime) +
+                 tv_seconds(&children.ru_stime) - tv_seconds(&begin_children.ru_stime);
+    long nvcsw = (self.ru_nvcsw - begin_self.ru_nvcsw) + (children.ru_nvcsw - begin_children.ru_nvcsw);
+    long nivcsw = (self.ru_nivcsw - begin_self.ru_nivcsw) + (children.ru_nivcsw - begin_children.ru_nivcsw);
+    print_line(out, fmt, "total", seconds_between(&begin_time, &now),
+               user, sys, maxrss, nvcsw, nivcsw);
+    fclose(out);
+    fflush(stdout);
+    fputs(report, stderr);
+    free(report);
+}
@@ -0,0 +1,40 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <sys/types.h>
+#include <sys/resource.h>
+
+/**
+ * Starts timing a command tree for the time keyword.
+ * While active, every foreground child the executor reaps with wait4()
+ * is recorded as a stage. Nested calls are ignored.
+ * @return 1 if this call started timing, 0 if timing was already active
+ * @post Shell and children resource usage baselines are taken
+ */
+int timing_begin(void);
+
+/**
+ * Notes that a stage was started, so its wall time can be measured.
+ * @param pid Child process id
+ * @param name Command name shown in the report
+ * @pre None; does nothing unless timing is active
+ */
+void timing_launch(pid_t pid, const char *name);
+
+/**
+ * Records the resource usage of a stage reaped with wait4().
+ * @param pid Child process id passed to timing_launch()
+ * @param usage Usage returned by wait4()
+ * @pre None; does nothing unless timing is active or pid is unknown
+ */
+void timing_reaped(pid_t pid, const struct rusage *usage);
+
+/**
+ * Stops timing and prints one line per stage plus a total to stderr.
+ * The line layout comes from JSHELL_TIMEFORMAT (see timing.c).
+ * @pre timing_begin() returned 1
+ * @post Recorded stages are freed
+ */
+void timing_end(void);
+
+#endif
@@ -0,0 +1,476 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vm.h"
+#include "shell.h"
+#include "command_registry.h"
+#include "options.h"
+#include "xtrace.h"
+#include "arena.h"
+#include "brace.h"
+
+int vm_disassemble_only = 0;
+
+// The VM has one register, the status of the last command run. Loops get
+// slots: a for loop's position (item, and offset into a range item), or a
+// while loop's saved status.
+typedef enum {
+    OP_RUN,         // execute_simple(node)
+    OP_BUILTIN,     // execute_builtin(aux, node), resolved at compile time
+    OP_JMP,         // pc = target
+    OP_JZ,          // pc = target if status == 0
+    OP_JNZ,         // pc = target if status != 0
+    OP_SET,         // status = arg
+    OP_TRACE,       // xtrace the keyword in aux
+    OP_CLEAR,       // slot[arg] = 0
+    OP_SAVE,        // slot[arg] = status
+    OP_LOAD,        // status = slot[arg]
+    OP_FOR_NEXT,    // bind the next item of plan aux at slot[arg], slot[arg+1],
+                    // else pc = target
+    OP_CASE,        // expand node's word; jump to the first arm it matches
+    OP_ARM          // case pattern aux with its body at target
+} vm_op_t;
+
+static const char *op_names[] = {
+    "run", "builtin", "jmp", "jz", "jnz", "set", "trace",
+    "clear", "save", "load", "for.next", "case", "arm"
+};
+
+typedef struct {
+    vm_op_t op;
+    int arg;
+    int target;
+    command_t *node;
+    const void *aux;
+} vm_insn_t;
+
+// A for list as the loop steps through it. A word that is one range
+// ({1..1000000}) is kept as bounds, and its items are formatted one at a
+// time, so memory does not grow with the range.
+typedef struct {
+    const char *word;       // NULL for a range
+    brace_range_t range;
+} for_item_t;
+
+typedef struct {
+    int count;
+    for_item_t items[];
+} for_plan_t;
+
+struct vm_program_t {
+    int count;
+    int slots;
+    vm_insn_t code[];
+};
+
+// Instructions are collected in a malloc'd buffer, then copied into the
+// tree's arena at their final size.
+typedef struct {
+    vm_insn_t *code;
+    int count;
+    int cap;
+    int slots;
+    int failed;
+} compiler_t;
+
+static int emit(compiler_t *c, vm_op_t op, int arg, command_t *node, const void *aux) {
+    if (c->count == c->cap) {
+        int cap = c->cap ? c->cap * 2 : 16;
+        vm_insn_t *grown = realloc(c->code, sizeof(vm_insn_t) * cap);
+        if (!grown) { c->failed = 1; return -1; }
+        c->code = grown;
+        c->cap = cap;
+    }
+    c->code[c->count] = (vm_insn_t){ op, arg, 0, node, aux };
+    return c->count++;
+}
+
+// Points the jump at `at` to the next instruction to be emitted.
+static void patch(compiler_t *c, int at) {
+    if (at >= 0) c->code[at].target = c->count;
+}
+
+static void compile_node(compiler_t *c, command_t *cmd);
+
+static const for_plan_t *plan_for(compiler_t *c, command_t *cmd) {
+    int n = 0;
+    while (cmd->for_list && cmd->for_list[n]) n++;
+    for_plan_t *plan = arena_alloc(cmd->arena, sizeof(for_plan_t) + sizeof(for_item_t) * n);
+    if (!plan) {
+        c->failed = 1;
+        return NULL;
+    }
+    plan->count = n;
+    for (int i = 0; i < n; i++)
+        if ((cmd->for_quoted && cmd->for_quoted[i]) ||
+            !brace_parse_range(cmd->for_list[i], &plan->items[i].range))
+            plan->items[i].word = cmd->for_list[i];
+    return plan;
+}
+
+// A missing condition is false, as it was for the tree walker.
+static void compile_condition(compiler_t *c, command_t *cond) {
+    if (cond) compile_node(c, cond);
+    else emit(c, OP_SET, 1, NULL, NULL);
+}
+
+static void compile_leaf(compiler_t *c, command_t *cmd) {
+    if (cmd->type == CMD_SIMPLE) {
+        if (!cmd->args || !cmd->args[0]) return;
+        // Registry builtins cannot be redefined, so the lookup is done once.
+        const command_entry_t *entry = cmd->next || cmd->background ? NULL : lookup_command(cmd->args[0]);
+        if (entry) {
+            emit(c, OP_BUILTIN, 0, cmd, entry);
+            return;
+        }
+    }
+    emit(c, OP_RUN, 0, cmd, NULL);
+}
+
+// Arms are emitted in order so the first matching pattern wins; the last
+// "*" entry is the fallthrough. Every arm starts with status 0.
+static void compile_case(compiler_t *c, command_t *cmd) {
+    if (!cmd->case_expression || !cmd->case_entries) {
+        emit(c, OP_SET, 0, NULL, NULL);
+        return;
+    }
+    emit(c, OP_CASE, 0, cmd, NULL);
+    int first_arm = c->count;
+    command_t *default_body = NULL;
+    for (int i = 0; i < cmd->case_entry_count; i++) {
+        case_entry_t *entry = cmd->case_entries[i];
+        if (strcmp(entry->pattern, "*") == 0) default_body = entry->body;
+        else emit(c, OP_ARM, i, NULL, entry->pattern);
+    }
+    int arms = c->count - first_arm;
+    int *ends = malloc(sizeof(int) * (arms + 1));
+    if (!ends) { c->failed = 1; return; }
+    int nends = 0;
+    compile_node(c, default_body);
+    ends[nends++] = emit(c, OP_JMP, 0, NULL, NULL);
+    for (int i = 0; i < arms && !c->failed; i++) {
+        command_t *body = cmd->case_entries[c->code[first_arm + i].arg]->body;
+        if (!body) {
+            ends[nends++] = first_arm + i;
+            continue;
+        }
+        c->code[first_arm + i].target = c->count;
+        compile_node(c, body);
+        if (i < arms - 1) ends[nends++] = emit(c, OP_JMP, 0, NULL, NULL);
+    }
+    for (int i = 0; i < nends; i++) patch(c, ends[i]);
+    free(ends);
+}
+
+static void compile_node(compiler_t *c, command_t *cmd) {
+    if (!cmd || c->failed) return;
+    int jump, end, top, slot;
+    switch (cmd->type) {
+        case CMD_SEQUENCE:
+            compile_node(c, cmd->then_branch);
+            compile_node(c, cmd->else_branch);
+            return;
+        case CMD_AND:
+        case CMD_OR:
+            compile_node(c, cmd->then_branch);
+            jump = emit(c, cmd->type == CMD_AND ? OP_JNZ : OP_JZ, 0, NULL, NULL);
+            compile_node(c, cmd->else_branch);
+            patch(c, jump);
+            return;
+        case CMD_IF:
+            // Status is the branch's, or 0 when no branch ran.
+            emit(c, OP_TRACE, 0, NULL, "if");
+            compile_condition(c, cmd->if_condition);
+            jump = emit(c, OP_JNZ, 0, NULL, NULL);
+            compile_node(c, cmd->then_branch);
+            end = emit(c, OP_JMP, 0, NULL, NULL);
+            patch(c, jump);
+            if (cmd->else_branch) compile_node(c, cmd->else_branch);
+            else emit(c, OP_SET, 0, NULL, NULL);
+            patch(c, end);
+            return;
+        case CMD_WHILE:
+            // The slot keeps the last body status; the failing condition's
+            // status is not the loop's.
+            slot = c->slots++;
+            emit(c, OP_CLEAR, slot, NULL, NULL);
+            top = emit(c, OP_TRACE, 0, NULL, "while");
+            compile_condition(c, cmd->while_condition);
+            jump = emit(c, OP_JNZ, 0, NULL, NULL);
+            compile_node(c, cmd->while_body);
+            emit(c, OP_SAVE, slot, NULL, NULL);
+            end = emit(c, OP_JMP, 0, NULL, NULL);
+            if (end >= 0) c->code[end].target = top;
+            patch(c, jump);
+            emit(c, OP_LOAD, slot, NULL, NULL);
+            return;
+        case CMD_FOR:
+            slot = c->slots;
+            c->slots += 2;
+            emit(c, OP_SET, 0, NULL, NULL);
+            emit(c, OP_CLEAR, slot, NULL, NULL);
+            emit(c, OP_CLEAR, slot + 1, NULL, NULL);
+            top = emit(c, OP_FOR_NEXT, slot, cmd, plan_for(c, cmd));
+            compile_node(c, cmd->for_body);
+            end = emit(c, OP_JMP, 0, NULL, NULL);
+            if (end >= 0) c->code[end].target = top;
+            patch(c, top);
+            return;
+        case CMD_CASE:
+            compile_case(c, cmd);
+            return;
+        default:
+            compile_leaf(c, cmd);
+            return;
+    }
+}
+
+vm_program_t *vm_compile(command_t *cmd) {
+    compiler_t c = { 0 };
+    compile_node(&c, cmd);
+    vm_program_t *program = NULL;
+    if (!c.failed)
+        program = arena_alloc(cmd->arena, sizeof(vm_program_t) + sizeof(vm_insn_t) * c.count);
+    if (program) {
+        program->count = c.count;
+        program->slots = c.slots;
+        if (c.count) memcpy(program->code, c.code, sizeof(vm_insn_t) * c.count);
+    }
+    free(c.code);
+    return program;
+}
+
+static vm_program_t *program_for(command_t *cmd) {
+    if (!cmd->program) cmd->program = vm_compile(cmd);
+    return cmd->program;
+}
+
+// Loop variables are bound through one putenv() buffer per name, rewritten
+// in place while the environment still points at it. setenv() copies every
+// value and glibc never frees the copies, so a long loop would grow
+// without bound.
+typedef struct binding_t {
+    char *text;             // "name=value"
+    size_t name_len;
+    size_t cap;
+    struct binding_t *next;
+} binding_t;
+
+static binding_t *bindings = NULL;
+
+static void bind_variable(const char *name, const char *value) {
+    if (!name || strchr(name, '=')) return;
+    size_t name_len = strlen(name);
+    size_t value_len = strlen(value);
+    binding_t *b = bindings;
+    while (b && (b->name_len != name_len || memcmp(b->text, name, name_len) != 0))
+        b = b->next;
+    if (!b) {
+        b = calloc(1, sizeof(binding_t));
+        if (!b) {
+            setenv(name, value, 1);
+            return;
+        }
+        b->name_len = name_len;
+        b->next = bindings;
+        bindings = b;
+    }
+    if (name_len + value_len + 2 > b->cap) {
+        size_t cap = name_len + value_len + 2;
+        if (cap < b->cap * 2) cap = b->cap * 2;
+        if (cap < name_len + BRACE_ITEM_MAX + 1) cap = name_len + BRACE_ITEM_MAX + 1;
+        char *text = malloc(cap);
+        if (!text) {
+            setenv(name, value, 1);
+            return;
+        }
+        memcpy(text, name, name_len);
+        text[name_len] = '=';
+        memcpy(text + name_len + 1, value, value_len + 1);
+        if (putenv(text) != 0) {
+            free(text);
+            setenv(name, value, 1);
+            return;
+        }
+        // The environment now holds text, so the old buffer is unreferenced.
+        free(b->text);
+        b->text = text;
+        b->cap = cap;
+        return;
+    }
+    int bound = getenv(name) == b->text + name_len + 1;
+    memcpy(b->text + name_len + 1, value, value_len + 1);
+    if (!bound) putenv(b->text);
+}
+
+// A case word starting with '$' names a variable; anything else is literal.
+static const char *case_word(const command_t *cmd) {
+    if (cmd->case_expression[0] != '$') return cmd->case_expression;
+    const char *value = getenv(cmd->case_expression + 1);
+    return value ? value : "";
+}
+
+static int vm_run(const vm_program_t *program) {
+    long slots[program->slots ? program->slots : 1];
+    const vm_insn_t *code = program->code;
+    int count = program->count;
+    int status = 0;
+    int pc = 0;
+    while (pc < count) {
+        const vm_insn_t *insn = &code[pc++];
+        switch (insn->op) {
+            case OP_RUN:
+                execute_simple(insn->node);
+                status = insn->node->last_status;
+                break;
+            case OP_BUILTIN:
+                execute_builtin(insn->aux, insn->node);
+                status = insn->node->last_status;
+                break;
+            case OP_JMP:
+                pc = insn->target;
+                break;
+            case OP_JZ:
+                if (status == 0) pc = insn->target;
+                break;
+            case OP_JNZ:
+                if (status != 0) pc = insn->target;
+                break;
+            case OP_SET:
+                status = insn->arg;
+                break;
+            case OP_TRACE:
+                if (opt_xtrace) xtrace_keyword("%s", (const char *)insn->aux);
+                break;
+            case OP_CLEAR:
+                slots[insn->arg] = 0;
+                break;
+            case OP_SAVE:
+                slots[insn->arg] = status;
+                break;
+            case OP_LOAD:
+                status = slots[insn->arg];
+                break;
+            case OP_FOR_NEXT: {
+                command_t *loop = insn->node;
+                const for_plan_t *plan = insn->aux;
+                long *index = &slots[insn->arg];
+                long *offset = &slots[insn->arg + 1];
+                char number[BRACE_ITEM_MAX];
+                const char *item = NULL;
+                while (!item && *index < plan->count) {
+                    const for_item_t *next = &plan->items[*index];
+                    if (next->word) {
+                        item = next->word;
+                        (*index)++;
+                    } else if ((unsigned long)*offset < brace_range_count(&next->range)) {
+                        item = brace_range_item(&next->range, (*offset)++, number);
+                    } else {
+                        (*index)++;
+                        *offset = 0;
+                    }
+                }
+                if (!item) {
+                    pc = insn->target;
+                    break;
+                }
+                bind_variable(loop->for_variable, item);
+                if (opt_xtrace) xtrace_keyword("for %s in %s", loop->for_variable, item);
+                break;
+            }
+            case OP_CASE: {
+                const char *word = case_word(insn->node);
+                if (opt_xtrace) xtrace_keyword("case %s in", word);
+                status = 0;
+                for (; pc < count && code[pc].op == OP_ARM; pc++) {
+                    if (strcmp(word, code[pc].aux) == 0) {
+                        pc = code[pc].target;
+                        break;
+                    }
+                }
+                break;
+            }
+            case OP_ARM:
+                break;
+        }
+    }
+    return status;
+}
+
+void vm_execute(command_t *cmd) {
+    vm_program_t *program = program_for(cmd);
+    if (!program) {
+        perror("vm_compile");
+        cmd->last_status = 1;
+        return;
+    }
+    cmd->last_status = vm_run(program);
+}
+
+static void describe_node(FILE *out, const command_t *cmd) {
+    for (const command_t *stage = cmd; stage; stage = stage->next) {
+        if (stage != cmd) fputs(" |", out);
+        if (stage->type == CMD_SUBSHELL) fputs(" ( ... )", out);
+        else if (stage->type == CMD_TIME) fputs(" time ...", out);
+        for (int i = 0; stage->type == CMD_SIMPLE && stage->args && stage->args[i]; i++)
+            fprintf(out, " %s", stage->args[i]);
+        if (stage->input_file) fprintf(out, " < %s", stage->input_file);
+        if (stage->output_file)
+            fprintf(out, " %s %s", stage->append_output ? ">>" : ">", stage->output_file);
+    }
+    if (cmd->background) fputs(" &", out);
+}
+
+static void dump_program(command_t *cmd, FILE *out, int indent) {
+    vm_program_t *program = program_for(cmd);
+    if (!program) {
+        fprintf(out, "%*s(out of memory)\n", indent, "");
+        return;
+    }
+    for (int pc = 0; pc < program->count; pc++) {
+        const vm_insn_t *insn = &program->code[pc];
+        fprintf(out, "%*s%04d  %-8s", indent, "", pc, op_names[insn->op]);
+        switch (insn->op) {
+            case OP_RUN:
+            case OP_BUILTIN:
+                describe_node(out, insn->node);
+                break;
+            case OP_JMP:
+            case OP_JZ:
+            case OP_JNZ:
+                fprintf(out, " %04d", insn->target);
+                break;
+            case OP_SET:
+                fprintf(out, " %d", insn->arg);
+                break;
+            case OP_TRACE:
+                fprintf(out, " %s", (const char *)insn->aux);
+                break;
+            case OP_CLEAR:
+            case OP_SAVE:
+            case OP_LOAD:
+                fprintf(out, " s%d", insn->arg);
+                break;
+            case OP_FOR_NEXT:
+                fprintf(out, " s%d %s, else %04d", insn->arg, insn->node->for_variable, insn->target);
+                break;
+            case OP_CASE:
+                fprintf(out, " %s", insn->node->case_expression);
+                break;
+            case OP_ARM:
+                fprintf(out, " %s %04d", (const char *)insn->aux, insn->target);
+                break;
+        }
+        fputc('\n', out);
+        // Subshell and time bodies are separate programs, compiled on first run.
+        command_t *body = NULL;
+        if (insn->op == OP_RUN && !insn->node->next)
+            body = insn->node->type == CMD_SUBSHELL ? insn->node->subshell_cmd :
+                   insn->node->type == CMD_TIME ? insn->node->timed_cmd : NULL;
+        if (body) dump_program(body, out, indent + 6);
+    }
+}
+
+void vm_disassemble(command_t *cmd, FILE *out) {
+    dump_program(cmd, out, 0);
+}
@@ -0,0 +1,43 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdio.h>
+#include "command.h"
+
+// Compound commands (sequences, && / ||, if, while, for, case) are lowered
+// into a flat instruction stream with resolved jumps and run by a small
+// loop instead of walking the tree. Simple commands, pipelines, subshells
+// and time stay leaves that the executor runs; registry builtins among
+// them are resolved once at compile time.
+typedef struct vm_program_t vm_program_t;
+
+extern int vm_disassemble_only;    // set by --disassemble
+
+/**
+ * Compiles a tree into a program allocated from the tree's arena.
+ * @param cmd Tree to compile
+ * @return Program, or NULL if out of memory
+ * @pre cmd is non-NULL
+ * @post The program lives until command_free() on the tree's root
+ */
+vm_program_t *vm_compile(command_t *cmd);
+
+/**
+ * Runs a compound command, compiling it on first use and caching the
+ * program on the node.
+ * @param cmd Compound command to run
+ * @pre cmd is non-NULL
+ * @post cmd->last_status holds the status of the last command run
+ */
+void vm_execute(command_t *cmd);
+
+/**
+ * Prints the instructions a tree compiles to, including the bodies of
+ * subshells and time keywords (--disassemble).
+ * @param cmd Tree to list
+ * @param out Stream to write to
+ * @pre cmd and out are non-NULL
+ */
+void vm_disassemble(command_t *cmd, FILE *out);
+
+#endif
@@ -0,0 +1,165 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "xtrace.h"
+#include "spawn.h"
+
+typedef struct {
+    pid_t pid;
+    char *name;
+    struct timespec forked;
+    struct timespec execed;
+    int has_exec;
+} traced_child_t;
+
+static traced_child_t *children = NULL;
+static int child_count = 0;
+static int child_cap = 0;
+static int trace_file_fd = -1;
+static char *trace_file_path = NULL;
+
+static double ts_seconds(const struct timespec *ts) {
+    return ts->tv_sec + ts->tv_nsec / 1e9;
+}
+
+// Picks the destination each time so the variables can change mid-script.
+static int trace_fd(void) {
+    const char *fd_var = getenv("JSHELL_XTRACEFD");
+    if (fd_var && *fd_var) {
+        char *end;
+        long fd = strtol(fd_var, &end, 10);
+        if (*end == '\0' && fd >= 0) return (int)fd;
+    }
+    const char *path = getenv("JSHELL_XTRACEFILE");
+    if (path && *path) {
+        if (trace_file_fd >= 0 && strcmp(trace_file_path, path) == 0)
+            return trace_file_fd;
+        if (trace_file_fd >= 0) close(trace_file_fd);
+        free(trace_file_path);
+        trace_file_path = strdup(path);
+        trace_file_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (trace_file_fd >= 0) return trace_file_fd;
+        perror(path);
+    }
+    return STDERR_FILENO;
+}
+
+// Emits "[<monotonic seconds>] + <text>\n" with a single write.
+static void emit(const char *text) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    char *line = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&line, &len);
+    if (!out) return;
+    fprintf(out, "[%.6f] + %s\n", ts_seconds(&now), text);
+    fclose(out);
+    fflush(stdout);
+    if (write(trace_fd(), line, len) < 0) { }
+    free(line);
+}
+
+static void format_command(FILE *out, char *const argv[], const command_t *cmd) {
+    for (int i = 0; argv[i]; i++)
+        fprintf(out, i ? " %s" : "%s", argv[i]);
+    if (cmd->input_file) fprintf(out, " < %s", cmd->input_file);
+    if (cmd->output_file) fprintf(out, " %s %s", cmd->append_output ? ">>" : ">", cmd->output_file);
+}
+
+void xtrace_command(char *const argv[], const command_t *cmd) {
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    if (!out) return;
+    format_command(out, argv, cmd);
+    if (cmd->background) fputs(" &", out);
+    fclose(out);
+    emit(text);
+    free(text);
+}
+
+void xtrace_pipeline(command_t *head) {
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    if (!out) return;
+    for (command_t *stage = head; stage; stage = stage->next) {
+        if (stage != head) fputs(" | ", out);
+        if (stage->type == CMD_SUBSHELL) {
+            fputs("( ... )", out);
+            continue;
+        }
+        char **argv = expand_command_args(stage, NULL);
+        if (!argv) continue;
+        format_command(out, argv, stage);
+        free(argv);
+    }
+    if (head->background) fputs(" &", out);
+    fclose(out);
+    emit(text);
+    free(text);
+}
+
+void xtrace_keyword(const char *fmt, ...) {
+    char *text = NULL;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vasprintf(&text, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    emit(text);
+    free(text);
+}
+
+void xtrace_launched(pid_t pid, const char *name, const struct timespec *forked,
+                     const struct timespec *execed) {
+    if (!opt_xtrace) return;
+    if (child_count == child_cap) {
+        int cap = child_cap ? child_cap * 2 : 8;
+        traced_child_t *grown = realloc(children, sizeof(traced_child_t) * cap);
+        if (!grown) return;
+        children = grown;
+        child_cap = cap;
+    }
+    traced_child_t *c = &children[child_count++];
+    c->pid = pid;
+    c->name = strdup(name ? name : "?");
+    c->forked = *forked;
+    c->has_exec = execed != NULL;
+    if (execed) c->execed = *execed;
+}
+
+void xtrace_reaped(pid_t pid, int status) {
+    if (WIFSTOPPED(status) || WIFCONTINUED(status)) return;
+    for (int i = 0; i < child_count; i++) {
+        if (children[i].pid != pid) continue;
+        traced_child_t c = children[i];
+        children[i] = children[--child_count];
+        if (opt_xtrace) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            const struct timespec *from = c.has_exec ? &c.execed : &c.forked;
+            char *text = NULL;
+            int n;
+            if (c.has_exec)
+                n = asprintf(&text, "%s (pid %d) exited %d: fork->exec %.6fs, exec->exit %.6fs",
+                             c.name, (int)pid, code, ts_seconds(&c.execed) - ts_seconds(&c.forked),
+                             ts_seconds(&now) - ts_seconds(from));
+            else
+                n = asprintf(&text, "%s (pid %d) exited %d: fork->exit %.6fs",
+                             c.name, (int)pid, code, ts_seconds(&now) - ts_seconds(from));
+            if (n >= 0) {
+                emit(text);
+                free(text);
+            }
+        }
+        free(c.name);
+        return;
+    }
+}
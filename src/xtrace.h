@@ -0,0 +1,55 @@
+#ifndef XTRACE_H
+#define XTRACE_H
+
+#include <time.h>
+#include <sys/types.h>
+#include "command.h"
+#include "options.h"
+
+// set -x tracing. Every line starts with a CLOCK_MONOTONIC timestamp and
+// goes to fd JSHELL_XTRACEFD, else to the file JSHELL_XTRACEFILE (appended),
+// else to stderr. Callers test opt_xtrace before building trace output.
+
+/**
+ * Traces a simple command after $VAR expansion.
+ * @param argv Expanded argument vector
+ * @param cmd Command supplying redirections and the background flag
+ * @pre opt_xtrace is set
+ */
+void xtrace_command(char *const argv[], const command_t *cmd);
+
+/**
+ * Traces a whole pipeline, each stage expanded, as "a | b | c".
+ * @param head First stage of the pipeline
+ * @pre opt_xtrace is set
+ */
+void xtrace_pipeline(command_t *head);
+
+/**
+ * Traces a control-structure step, e.g. "for i in 3" or "while".
+ * @param fmt printf-style format
+ * @pre opt_xtrace is set
+ */
+void xtrace_keyword(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Remembers when a child was forked and when it exec'd.
+ * @param pid Child process id
+ * @param name Command name for the reap line
+ * @param forked Time just before fork/spawn
+ * @param execed Time the exec succeeded, or NULL if the child does not exec
+ * @pre None; does nothing unless opt_xtrace is set
+ */
+void xtrace_launched(pid_t pid, const char *name, const struct timespec *forked,
+                     const struct timespec *execed);
+
+/**
+ * Traces the exit of a child recorded by xtrace_launched(), with its
+ * fork-to-exec and exec-to-exit latencies.
+ * @param pid Reaped child
+ * @param status Status from waitpid()/wait4()
+ * @pre None; unknown pids are ignored
+ */
+void xtrace_reaped(pid_t pid, int status);
+
+#endif